@@ -24,10 +24,36 @@
 struct AdcContext {
     bool init;
     uint32_t *rawData;
-    ADC_Data *data;
+    // ADC_Data entries, or ADC_Sample entries if packed.
+    void *data;
+    bool packed;
     uint16_t fifoSize;
     uint8_t channelsCount;
+    uint16_t channelMask;
     void (*callback)(int32_t);
+
+    // Per channel boxcar sums, and the data entry each channel's average goes to.
+    uint16_t decimation;
+    uint16_t ready;
+    uint32_t sum[MT3620_ADC_CHANNEL_COUNT];
+    uint16_t sumCount[MT3620_ADC_CHANNEL_COUNT];
+    uint8_t slot[MT3620_ADC_CHANNEL_COUNT];
+
+    // Blocks completed by the handler and released by the application, free-running, so
+    // produced - consumed blocks are owned by the application.
+    uint8_t blockCount;
+    uint32_t blockSize;
+    volatile uint32_t produced;
+    volatile uint32_t consumed;
+    uint32_t blockLength[ADC_BLOCK_COUNT_MAX];
+    uint32_t overruns;
+    // Scans of every channel the blocks cover, and those of the dropped blocks.
+    uint32_t blockScans[ADC_BLOCK_COUNT_MAX];
+    uint32_t overrunScans;
+
+    // Analog settings, applied once by ADC_Configure().
+    bool configured;
+    ADC_Config config;
 };
 
 static AdcContext context[MT3620_ADC_COUNT] = {0};
@@ -55,6 +81,19 @@ static ADC_CountChannels(uint16_t channelMask)
     return numChannels;
 }
 
+static void ADC_FifoClear(void)
+{
+#ifdef ADC_FIFO_CLEAR
+    while (true) {
+        mt3620_adc_fifo_debug16_t debug16 = (mt3620_adc_fifo_debug16_t)mt3620_adc->adc_fifo_debug16;
+        if (debug16.read_ptr == debug16.write_ptr) {
+            break;
+        }
+        (void)mt3620_adc->adc_fifo_rbr;
+    }
+#endif
+}
+
 AdcContext *ADC_Open(Platform_Unit unit)
 {
     uint32_t id = ADC_UnitToID (unit);
@@ -74,8 +113,14 @@ AdcContext *ADC_Open(Platform_Unit unit)
     context[id].callback = NULL;
     context[id].rawData = NULL;
     context[id].data = NULL;
+    context[id].packed = false;
     context[id].fifoSize = 0;
     context[id].channelsCount = 0;
+    context[id].channelMask = 0;
+    context[id].decimation = 1;
+    context[id].blockCount = 1;
+    context[id].configured = false;
+    context[id].config = (ADC_Config)ADC_CONFIG_DEFAULT;
 
     //Manually reset DMA and ADC
     mt3620_adc->adc_global_ctrl = 0;
@@ -108,24 +153,106 @@ void ADC_Close(AdcContext *handle)
     NVIC_DisableIRQ(MT3620_ADC_INTERRUPT);
 
     handle->init = false;
+    handle->configured = false;
     handle->rawData = NULL;
     handle->data = NULL;
     handle->fifoSize = 0;
     handle->channelsCount = 0;
+    handle->channelMask = 0;
     handle->callback = NULL;
 }
 
-static int32_t ADC_Read(
-    AdcContext *handle, void (*callback)(int32_t status),
-    uint32_t dmaFifoSize, ADC_Data *data,
-    uint32_t *rawData, uint16_t channel,
-    bool periodic, uint32_t frequency,
-    uint16_t referenceVoltage)
+int32_t ADC_SetDecimation(AdcContext *handle, uint32_t factor)
 {
-    handle->callback = callback;
-    handle->fifoSize = dmaFifoSize;
-    handle->rawData = rawData;
-    handle->data = data;
+    if (!handle || !handle->init || (factor == 0) || (factor > ADC_DECIMATION_MAX)) {
+        return ERROR_PARAMETER;
+    }
+
+    handle->decimation = factor;
+    return ERROR_NONE;
+}
+
+int32_t ADC_SetBlockCount(AdcContext *handle, uint32_t count)
+{
+    if (!handle || !handle->init || (count == 0) || (count > ADC_BLOCK_COUNT_MAX)) {
+        return ERROR_PARAMETER;
+    }
+
+    handle->blockCount = count;
+    return ERROR_NONE;
+}
+
+uint32_t ADC_BlocksReady(AdcContext *handle)
+{
+    return handle->produced - handle->consumed;
+}
+
+static inline void *ADC_BlockAddress(AdcContext *handle, uint32_t block)
+{
+    uint32_t index = block * handle->blockSize;
+    if (handle->packed) {
+        return &((ADC_Sample *)handle->data)[index];
+    }
+    return &((ADC_Data *)handle->data)[index];
+}
+
+static void *ADC_OldestBlock(AdcContext *handle, uint32_t *count)
+{
+    uint32_t consumed = handle->consumed;
+    if (handle->produced == consumed) {
+        return NULL;
+    }
+
+    uint32_t block = consumed % handle->blockCount;
+    if (count) {
+        *count = handle->blockLength[block];
+    }
+    return ADC_BlockAddress(handle, block);
+}
+
+ADC_Data *ADC_GetBlock(AdcContext *handle, uint32_t *count)
+{
+    return handle->packed ? NULL : ADC_OldestBlock(handle, count);
+}
+
+ADC_Sample *ADC_GetPackedBlock(AdcContext *handle, uint32_t *count)
+{
+    return handle->packed ? ADC_OldestBlock(handle, count) : NULL;
+}
+
+void ADC_ReleaseBlock(AdcContext *handle)
+{
+    if (handle->produced != handle->consumed) {
+        handle->consumed++;
+    }
+}
+
+uint32_t ADC_GetOverruns(AdcContext *handle)
+{
+    return handle->overruns;
+}
+
+uint32_t ADC_GetBlockScans(AdcContext *handle)
+{
+    uint32_t consumed = handle->consumed;
+    if (handle->produced == consumed) {
+        return 0;
+    }
+    return handle->blockScans[consumed % handle->blockCount];
+}
+
+uint32_t ADC_GetOverrunScans(AdcContext *handle)
+{
+    return handle->overrunScans;
+}
+
+int32_t ADC_Configure(AdcContext *handle, const ADC_Config *config)
+{
+    if (!handle || !handle->init || !config
+        || (config->averaging > ADC_AVERAGE_64) || (config->channelTime > 15)
+        || (config->initTime > 127)) {
+        return ERROR_PARAMETER;
+    }
 
     mt3620_adc_ctl3_t ctl3 = { .mask = mt3620_adc->adc_ctl3 };
     ctl3.comp_time_delay = 1;
@@ -138,6 +265,7 @@ static int32_t ADC_Read(
     ctl3.auxadc_clk_gen_en = 1;
     ctl3.auxadc_pmu_clk_inv = 0;
     ctl3.auxadc_clk_src = 0;
+    uint16_t referenceVoltage = config->referenceVoltage;
     if (referenceVoltage > ADC_VREF_1V8_MIN && referenceVoltage < ADC_VREF_1V8_MAX) {
         ctl3.vcm_azure_en = 1;
     }
@@ -153,49 +281,86 @@ static int32_t ADC_Read(
 
     mt3620_adc_ctl0_t ctl0 = { .mask = mt3620_adc->adc_ctl0 };
     ctl0.adc_fsm_en = 0;
-    ctl0.reg_avg_mode = 0;
-    ctl0.reg_t_ch = 8;
+    ctl0.reg_avg_mode = config->averaging;
+    ctl0.reg_t_ch = config->channelTime;
     ctl0.pmode_en = 0;
-    ctl0.reg_t_init = 20;
+    ctl0.reg_t_init = config->initTime;
     ctl0.reg_ch_map = 0;
     mt3620_adc->adc_ctl0 = ctl0.mask;
 
-#ifdef ADC_FIFO_CLEAR
-    while (true) {
-        mt3620_adc_fifo_debug16_t debug16 = (mt3620_adc_fifo_debug16_t)mt3620_adc->adc_fifo_debug16;
-        if (debug16.read_ptr == debug16.write_ptr) {
-            break;
-        }
-        (void)mt3620_adc->adc_fifo_rbr;
-    }
-#endif
+    ADC_FifoClear();
 
     /* Wait for time specified in datasheet */
     GPT *timer = GPT_Open(MT3620_UNIT_GPT3, MT3620_GPT_3_LOW_SPEED, GPT_MODE_NONE);
     GPT_WaitTimer_Blocking(timer, 50, GPT_UNITS_MICROSEC);
     GPT_Close(timer);
 
-    /* Set trigger level based on number of channels selected */
+    handle->config = *config;
+    handle->configured = true;
+    return ERROR_NONE;
+}
+
+// Sets the channels of the next conversions and lays out the data blocks for them.
+static int32_t ADC_SetChannels(AdcContext *handle, uint16_t channel)
+{
     uint8_t numChannels = ADC_CountChannels(channel);
 
+    //Check fifo size is at least as great as the number of channels, and a power of two
+    //as the interrupt handler wraps its read pointer with a mask
+    if ((numChannels == 0) || (handle->fifoSize < numChannels)
+        || (handle->fifoSize & (handle->fifoSize - 1))) {
+        return ERROR_ADC_FIFO_INVALID;
+    }
+
     handle->channelsCount = numChannels;
+    handle->channelMask = channel;
+
+    //Averages are stored one per channel, in ascending channel order
+    uint8_t slot = 0;
+    unsigned c;
+    for (c = 0; c < MT3620_ADC_CHANNEL_COUNT; c++) {
+        handle->slot[c] = slot;
+        handle->sum[c] = 0;
+        handle->sumCount[c] = 0;
+        if (channel & (1U << c)) {
+            slot++;
+        }
+    }
+    handle->ready = 0;
 
-    //Check fifo size is at least as great as the number of channels
-    if (handle->fifoSize < numChannels) {
-        return ERROR_ADC_FIFO_INVALID;
+    handle->blockSize = (handle->decimation > 1) ? numChannels : handle->fifoSize;
+    return ERROR_NONE;
+}
+
+// Number of FIFO entries which raise the DMA interrupt.
+static uint32_t ADC_DmaThreshold(AdcContext *handle, bool periodic)
+{
+    if (!periodic) {
+        // A one-shot conversion completes with one entry per channel, it's never decimated.
+        return handle->channelsCount;
     }
+    if (handle->decimation > 1) {
+        // One interrupt per average of every channel, if that leaves the FIFO some headroom.
+        uint32_t entries = handle->decimation * handle->channelsCount;
+        if (entries <= ((3 * handle->fifoSize) / 4)) {
+            return entries;
+        }
+    }
+    if (handle->fifoSize == 1) {
+        return 1;
+    }
+    return ((3 * handle->fifoSize) / 4);
+}
 
+static void ADC_DmaStart(AdcContext *handle, bool periodic)
+{
     //Set DMA registers
     mt3620_dma_global->ch_en_set = (1 << MT3620_ADC_DMA_CHANNEL);
 
     MT3620_DMA_FIELD_WRITE(MT3620_ADC_DMA_CHANNEL, start, str, false);
     mt3620_dma[MT3620_ADC_DMA_CHANNEL].pgmaddr = handle->rawData;
     mt3620_dma[MT3620_ADC_DMA_CHANNEL].ffsize  = handle->fifoSize;
-    if (handle->fifoSize == 1) {
-        mt3620_dma[MT3620_ADC_DMA_CHANNEL].count = 1;
-    } else {
-        mt3620_dma[MT3620_ADC_DMA_CHANNEL].count   = ((3 * mt3620_dma[MT3620_ADC_DMA_CHANNEL].ffsize) / 4);
-    }
+    mt3620_dma[MT3620_ADC_DMA_CHANNEL].count   = ADC_DmaThreshold(handle, periodic);
     mt3620_dma[MT3620_ADC_DMA_CHANNEL].fixaddr = (void*)&mt3620_adc->adc_fifo_rbr;
     mt3620_dma[MT3620_ADC_DMA_CHANNEL].swptr   = 0;
 
@@ -212,29 +377,119 @@ static int32_t ADC_Read(
     mt3620_dma[MT3620_ADC_DMA_CHANNEL].con = con.mask;
 
     MT3620_DMA_FIELD_WRITE(MT3620_ADC_DMA_CHANNEL, start, str, true);
+}
 
-    /* Select ADC channel and enable ADC finite state machine */
-    ctl0.mask = mt3620_adc->adc_ctl0;
-    if (periodic) {
-        if (frequency > ADC_CLK_FREQUENCY) {
-            return ERROR_ADC_FREQUENCY_UNSUPPORTED;
-        }
-        mt3620_adc->reg_period = (ADC_CLK_FREQUENCY / frequency) - 1;
-        ctl0.pmode_en = periodic;
-    }
+// Selects the channels and (re)starts the ADC finite state machine.
+static void ADC_FsmStart(uint16_t channel, bool periodic)
+{
+    mt3620_adc_ctl0_t ctl0 = { .mask = mt3620_adc->adc_ctl0 };
+    ctl0.adc_fsm_en = 0;
+    mt3620_adc->adc_ctl0 = ctl0.mask;
+
+    ctl0.pmode_en = periodic;
     ctl0.reg_ch_map = channel;
     ctl0.adc_fsm_en = 1;
     mt3620_adc->adc_ctl0 = ctl0.mask;
+}
+
+static int32_t ADC_Read(
+    AdcContext *handle, void (*callback)(int32_t status),
+    uint32_t dmaFifoSize, void *data, bool packed,
+    uint32_t *rawData, uint16_t channel,
+    bool periodic, uint32_t frequency,
+    uint16_t referenceVoltage)
+{
+    // The analog front end only needs setting up again for a different reference.
+    int32_t status;
+    if (!handle->configured || (handle->config.referenceVoltage != referenceVoltage)) {
+        ADC_Config config = handle->config;
+        config.referenceVoltage = referenceVoltage;
+        status = ADC_Configure(handle, &config);
+        if (status != ERROR_NONE) {
+            return status;
+        }
+    } else {
+        mt3620_adc_ctl0_t ctl0 = { .mask = mt3620_adc->adc_ctl0 };
+        ctl0.adc_fsm_en = 0;
+        ctl0.pmode_en = 0;
+        mt3620_adc->adc_ctl0 = ctl0.mask;
+        ADC_FifoClear();
+    }
+
+    // A one-shot scan never completes an average.
+    if (!periodic && (handle->decimation > 1)) {
+        return ERROR_PARAMETER;
+    }
+
+    if (periodic && (frequency == 0)) {
+        frequency = handle->config.frequency;
+    }
+    if (periodic && ((frequency == 0) || (frequency > ADC_CLK_FREQUENCY))) {
+        return ERROR_ADC_FREQUENCY_UNSUPPORTED;
+    }
+
+    handle->callback = callback;
+    handle->fifoSize = dmaFifoSize;
+    handle->rawData = rawData;
+    handle->data = data;
+    handle->packed = packed;
+
+    status = ADC_SetChannels(handle, channel);
+    if (status != ERROR_NONE) {
+        return status;
+    }
+    handle->produced = 0;
+    handle->consumed = 0;
+    handle->overruns = 0;
+    handle->overrunScans = 0;
+
+    ADC_DmaStart(handle, periodic);
+
+    if (periodic) {
+        mt3620_adc->reg_period = (ADC_CLK_FREQUENCY / frequency) - 1;
+    }
+    ADC_FsmStart(channel, periodic);
 
     return ERROR_NONE;
 }
 
+int32_t ADC_Trigger(AdcContext *handle, uint16_t channel)
+{
+    if (!handle || !handle->init || !handle->configured || !handle->data) {
+        return ERROR_HARDWARE_STATE;
+    }
+
+    mt3620_adc_ctl0_t ctl0 = { .mask = mt3620_adc->adc_ctl0 };
+    if (ctl0.pmode_en) {
+        return ERROR_BUSY;
+    }
+
+    if (handle->decimation > 1) {
+        return ERROR_PARAMETER;
+    }
+
+    if (channel != handle->channelMask) {
+        int32_t status = ADC_SetChannels(handle, channel);
+        if (status != ERROR_NONE) {
+            return status;
+        }
+        mt3620_dma[MT3620_ADC_DMA_CHANNEL].count = ADC_DmaThreshold(handle, false);
+    }
+
+    if (!MT3620_DMA_FIELD_READ(MT3620_ADC_DMA_CHANNEL, start, str)) {
+        ADC_DmaStart(handle, false);
+    }
+
+    ADC_FsmStart(channel, false);
+    return ERROR_NONE;
+}
+
 int32_t ADC_ReadAsync(
     AdcContext *handle, void (*callback)(int32_t status),
     uint32_t dmaFifoSize, uint32_t *rawData,
     ADC_Data *data, uint16_t channel, uint16_t referenceVoltage)
 {
-    return ADC_Read(handle, callback, dmaFifoSize, data, rawData, channel,
+    return ADC_Read(handle, callback, dmaFifoSize, data, false, rawData, channel,
             false, 0, referenceVoltage);
 }
 
@@ -243,7 +498,16 @@ int32_t ADC_ReadPeriodicAsync(
     uint32_t dmaFifoSize, ADC_Data *data, uint32_t *rawData,
     uint16_t channel, uint32_t frequency, uint16_t referenceVoltage)
 {
-    return ADC_Read(handle, callback, dmaFifoSize, data, rawData, channel,
+    return ADC_Read(handle, callback, dmaFifoSize, data, false, rawData, channel,
+            true, frequency, referenceVoltage);
+}
+
+int32_t ADC_ReadPeriodicPackedAsync(
+    AdcContext *handle, void (*callback)(int32_t status),
+    uint32_t dmaFifoSize, ADC_Sample *data, uint32_t *rawData,
+    uint16_t channel, uint32_t frequency, uint16_t referenceVoltage)
+{
+    return ADC_Read(handle, callback, dmaFifoSize, data, true, rawData, channel,
             true, frequency, referenceVoltage);
 }
 
@@ -266,7 +530,7 @@ int32_t ADC_ReadSync(
     }
 
     ADC_ReadSync_Ready = false;
-    int32_t status = ADC_Read(handle, &ADC_ReadSync_Callback, dmaFifoSize, data, rawData,
+    int32_t status = ADC_Read(handle, &ADC_ReadSync_Callback, dmaFifoSize, data, false, rawData,
             channel, false, 0, referenceVoltage);
 
     if (status != ERROR_NONE) {
@@ -283,6 +547,48 @@ int32_t ADC_ReadSync(
     return ADC_ReadSync_Status;
 }
 
+static inline void ADC_Accumulate(AdcContext *handle, void *block, uint32_t raw)
+{
+    uint32_t channel = raw & 0xF;
+    if ((channel >= MT3620_ADC_CHANNEL_COUNT) || !(handle->channelMask & (1U << channel))) {
+        return;
+    }
+
+    handle->sum[channel] += (raw >> 4) & 0xFFF;
+    if (++handle->sumCount[channel] < handle->decimation) {
+        return;
+    }
+
+    uint32_t value = (handle->sum[channel] + (handle->decimation / 2)) / handle->decimation;
+    if (handle->packed) {
+        ((ADC_Sample *)block)[handle->slot[channel]] = ADC_SAMPLE(channel, value);
+    } else {
+        ADC_Data *data = &((ADC_Data *)block)[handle->slot[channel]];
+        data->value   = value;
+        data->channel = channel;
+    }
+    handle->sum[channel] = 0;
+    handle->sumCount[channel] = 0;
+    handle->ready |= (1U << channel);
+}
+
+// Hands a complete block to the application, unless it owns all other blocks.
+static inline void ADC_BlockDone(AdcContext *handle, uint32_t length)
+{
+    uint32_t scans = (handle->decimation > 1) ? handle->decimation : (length / handle->channelsCount);
+    if (handle->blockCount > 1) {
+        if ((handle->produced - handle->consumed) >= (handle->blockCount - 1U)) {
+            handle->overruns++;
+            handle->overrunScans += scans;
+            return;
+        }
+        handle->blockLength[handle->produced % handle->blockCount] = length;
+        handle->blockScans[handle->produced % handle->blockCount] = scans;
+        handle->produced++;
+    }
+    handle->callback(length);
+}
+
 void m4dma_irq_b_adc(void)
 {
     AdcContext *handle = &context[0];
@@ -292,11 +598,33 @@ void m4dma_irq_b_adc(void)
     unsigned count = dma->ffcnt;
     unsigned swptr = MT3620_DMA_FIELD_READ(MT3620_ADC_DMA_CHANNEL, swptr, swptr) >> 2;
 
+    void *block = ADC_BlockAddress(handle, handle->produced % handle->blockCount);
+
+    // FIFO words hold the value in bits 4 to 15 and the channel in bits 0 to 3.
     unsigned i;
-    for (i = 0; i < count; i++) {
-        unsigned j = (swptr + i) & (handle->fifoSize - 1);
-        handle->data[i].value   = (handle->rawData[j] >> 4) & 0xFFF;
-        handle->data[i].channel = handle->rawData[j] & 0xF;
+    if (handle->decimation > 1) {
+        // Every completed set of averages is handed over, a late interrupt may complete more.
+        for (i = 0; i < count; i++) {
+            ADC_Accumulate(handle, block, handle->rawData[(swptr + i) & (handle->fifoSize - 1)]);
+            if (handle->ready == handle->channelMask) {
+                handle->ready = 0;
+                ADC_BlockDone(handle, handle->channelsCount);
+                block = ADC_BlockAddress(handle, handle->produced % handle->blockCount);
+            }
+        }
+    } else if (handle->packed) {
+        ADC_Sample *samples = block;
+        for (i = 0; i < count; i++) {
+            uint32_t raw = handle->rawData[(swptr + i) & (handle->fifoSize - 1)];
+            samples[i] = ADC_SAMPLE(raw, raw >> 4);
+        }
+    } else {
+        ADC_Data *data = block;
+        for (i = 0; i < count; i++) {
+            unsigned j = (swptr + i) & (handle->fifoSize - 1);
+            data[i].value   = (handle->rawData[j] >> 4) & 0xFFF;
+            data[i].channel = handle->rawData[j] & 0xF;
+        }
     }
 
     // Increment swptr by count and toggle wrap bit if we wrapped
@@ -308,5 +636,7 @@ void m4dma_irq_b_adc(void)
     MT3620_DMA_FIELD_WRITE(MT3620_ADC_DMA_CHANNEL, ackint, ack, 1);
 
     //Pass the number of data copied back to the function caller
-    handle->callback(count);
+    if ((handle->decimation <= 1) && ((count > 0) || (handle->blockCount == 1))) {
+        ADC_BlockDone(handle, count);
+    }
 }
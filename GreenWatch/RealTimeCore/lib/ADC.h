@@ -21,6 +21,12 @@ typedef struct AdcContext AdcContext;
 /// <summary>Returned when a voltage reference for the V_ref setting is unsupported.</summary>
 #define ERROR_ADC_VREF_UNSUPPORTED             (ERROR_SPECIFIC - 3)
 
+/// <summary>Largest number of conversions averaged into one value, see ADC_SetDecimation.</summary>
+#define ADC_DECIMATION_MAX 1024
+
+/// <summary>Largest number of data blocks, see ADC_SetBlockCount.</summary>
+#define ADC_BLOCK_COUNT_MAX 4
+
 /// <summary>A data structure for separating ADC data from the channel number.</summary>
 typedef struct {
     /// <summary>
@@ -33,6 +39,58 @@ typedef struct {
     uint32_t channel;
 } ADC_Data;
 
+/// <summary>
+/// <para>Packed ADC data: the 12 bit value in bits 0 to 11 and the channel in bits 12 to 15,
+/// a quarter of the size of ADC_Data.</para>
+/// </summary>
+typedef uint16_t ADC_Sample;
+
+#define ADC_SAMPLE(channel, value) ((ADC_Sample)((((channel) & 0xF) << 12) | ((value) & 0xFFF)))
+#define ADC_SAMPLE_VALUE(sample)   ((sample) & 0xFFF)
+#define ADC_SAMPLE_CHANNEL(sample) (((sample) >> 12) & 0xF)
+
+/// <summary>Number of conversions the ADC averages into each FIFO entry.</summary>
+typedef enum {
+    ADC_AVERAGE_1 = 0,
+    ADC_AVERAGE_2,
+    ADC_AVERAGE_4,
+    ADC_AVERAGE_8,
+    ADC_AVERAGE_16,
+    ADC_AVERAGE_32,
+    ADC_AVERAGE_64,
+} ADC_Average;
+
+/// <summary>Analog settings and timing of an ADC block, see ADC_Configure.</summary>
+typedef struct {
+    /// <summary>
+    /// <para>The reference voltage being used in millivolts, see ADC_ReadAsync.</para>
+    /// </summary>
+    uint16_t referenceVoltage;
+    /// <summary>
+    /// <para>Hardware averaging: each FIFO entry is the mean of this many conversions of a
+    /// channel, so the FIFO and the interrupt rate drop by the same factor.</para>
+    /// </summary>
+    ADC_Average averaging;
+    /// <summary>Settling time after switching channels, 0 to 15 ADC clocks.</summary>
+    uint8_t channelTime;
+    /// <summary>Settling time after the state machine starts, 0 to 127 ADC clocks.</summary>
+    uint8_t initTime;
+    /// <summary>
+    /// <para>Rate of the scans of periodic reads which are started with a frequency of 0
+    /// [Hz]. A scan must fit in the period, including the averaged conversions.</para>
+    /// </summary>
+    uint32_t frequency;
+} ADC_Config;
+
+/// <summary>The settings used until ADC_Configure() is called.</summary>
+#define ADC_CONFIG_DEFAULT { \
+    .referenceVoltage = 1800,          \
+    .averaging        = ADC_AVERAGE_1, \
+    .channelTime      = 8,             \
+    .initTime         = 20,            \
+    .frequency        = 1000,          \
+}
+
 /// <summary>
 /// <para>The application has to call this function to register a callback and a buffer.
 /// The callback will be called in the interrupt and give the user a status return. The
@@ -51,6 +109,98 @@ AdcContext *ADC_Open(Platform_Unit unit);
 /// <param name="handle">The ADC handle which is to be released.</param>
 void ADC_Close(AdcContext *handle);
 
+/// <summary>
+/// <para>Sets up the analog front end of the ADC block and waits for it to settle (50 us).
+/// This is done once per session: reads with the same reference voltage and ADC_Trigger()
+/// only reprogram the channels, the DMA and the state machine.</para>
+/// </summary>
+/// <param name="handle">The ADC block to configure.</param>
+/// <param name="config">The settings to apply.</param>
+/// <returns>ERROR_NONE on success, ERROR_PARAMETER for settings out of range or
+/// ERROR_ADC_VREF_UNSUPPORTED.</returns>
+int32_t ADC_Configure(AdcContext *handle, const ADC_Config *config);
+
+/// <summary>
+/// <para>Starts another one-shot conversion of the given channels into the buffers of the
+/// last read, with the same callback. Only the channel map, the state machine enable and, if
+/// it was stopped, the DMA channel are written, so a conversion is re-armed in
+/// microseconds.</para>
+/// </summary>
+/// <param name="handle">The ADC block to trigger.</param>
+/// <param name="channel">Which ADC channels to convert, a bit mask as for ADC_ReadAsync.</param>
+/// <returns>ERROR_NONE on success, ERROR_HARDWARE_STATE if no read was set up yet,
+/// ERROR_BUSY during a periodic read, ERROR_PARAMETER with decimation or
+/// ERROR_ADC_FIFO_INVALID.</returns>
+int32_t ADC_Trigger(AdcContext *handle, uint16_t channel);
+
+/// <summary>
+/// <para>Sets how many conversions of each channel are averaged into one value, applies to the
+/// following reads. The default of 1 passes every conversion through.</para>
+/// <para>With a factor above 1 the interrupt handler sums the conversions of each channel from
+/// the DMA FIFO (boxcar filter) and a block holds one value per enabled channel, in ascending
+/// channel order. The callback is called with the number of channels once every channel has a
+/// new average, once per average, so with several blocks no conversion is lost. Periodic reads
+/// raise the DMA interrupt every factor scans if factor times the number of channels fits in
+/// three quarters of the FIFO, and every three quarters of the FIFO otherwise.</para>
+/// <para>Decimation needs periodic reads: one-shot reads and ADC_Trigger() fail with
+/// ERROR_PARAMETER while the factor is above 1.</para>
+/// </summary>
+/// <param name="handle">The ADC block to configure.</param>
+/// <param name="factor">Conversions per value, 1 to ADC_DECIMATION_MAX.</param>
+/// <returns>ERROR_NONE on success or ERROR_PARAMETER for an invalid factor.</returns>
+int32_t ADC_SetDecimation(AdcContext *handle, uint32_t factor);
+
+/// <summary>
+/// <para>Splits the data buffer of the following reads in count blocks, so the interrupt
+/// handler fills one block while the application reads others. The default of 1 writes every
+/// interrupt's data to the start of the buffer.</para>
+/// <para>A block is complete when the callback is called; the application then owns it until
+/// it calls ADC_ReleaseBlock(), blocks are owned and released oldest first. One block is
+/// always left to the handler: if the application owns all others when a block completes,
+/// the block is dropped, counted in ADC_GetOverruns(), and filled again.</para>
+/// <para>The data buffer holds count blocks of dmaFifoSize entries, or of one entry per
+/// channel with decimation.</para>
+/// </summary>
+/// <param name="handle">The ADC block to configure.</param>
+/// <param name="count">Number of blocks, 1 to ADC_BLOCK_COUNT_MAX.</param>
+/// <returns>ERROR_NONE on success or ERROR_PARAMETER for an invalid count.</returns>
+int32_t ADC_SetBlockCount(AdcContext *handle, uint32_t count);
+
+/// <summary>Returns the number of complete blocks owned by the application.</summary>
+uint32_t ADC_BlocksReady(AdcContext *handle);
+
+/// <summary>
+/// <para>Returns the oldest block owned by the application, without releasing it.</para>
+/// </summary>
+/// <param name="handle">The ADC block to read.</param>
+/// <param name="count">Receives the number of entries in the block.</param>
+/// <returns>The block, or NULL if the application owns none or the read stores packed
+/// data.</returns>
+ADC_Data *ADC_GetBlock(AdcContext *handle, uint32_t *count);
+
+/// <summary>
+/// <para>ADC_GetBlock() for reads started with ADC_ReadPeriodicPackedAsync().</para>
+/// </summary>
+ADC_Sample *ADC_GetPackedBlock(AdcContext *handle, uint32_t *count);
+
+/// <summary>Hands the oldest block owned by the application back to the interrupt
+/// handler.</summary>
+void ADC_ReleaseBlock(AdcContext *handle);
+
+/// <summary>Returns the number of blocks dropped since the last read was started.</summary>
+uint32_t ADC_GetOverruns(AdcContext *handle);
+
+/// <summary>
+/// <para>Returns the number of scans of the channels the oldest block owned by the
+/// application covers: the decimation factor, or the entries per channel without decimation.
+/// 0 if the application owns no block.</para>
+/// </summary>
+uint32_t ADC_GetBlockScans(AdcContext *handle);
+
+/// <summary>Returns the number of scans the blocks dropped since the last read was started
+/// covered, see ADC_GetBlockScans().</summary>
+uint32_t ADC_GetOverrunScans(AdcContext *handle);
+
 /// <summary>
 /// <para>Configures the appropriate ADC block to fill the data buffer
 /// and trigger interrupt when ADC data is ready.</para>
@@ -76,17 +226,22 @@ int32_t ADC_ReadAsync(
 /// <summary>
 /// <para>Configures the appropriate ADC block to periodically fill the data buffer
 /// and trigger interrupt when ADC data is ready. </para>
+/// <para>All enabled channels are converted in turn in each period. The interrupt is raised
+/// when the DMA FIFO is three quarters full, so a deep FIFO takes one interrupt per block of
+/// conversions rather than per conversion.</para>
 /// </summary>
 /// <param name="handle">The ADC block to enable.</param>
 /// <param name="callback">A pointer to a function that will be called during an interrupt.
 /// The status parameter will be set equal to the number of values copied in to the data buffer.
 /// </param>
-/// <param name="dmaFifoSize">How many entries the DMA buffer can hold.</param>
-/// <param name="data">A pointer to a data structure used to store ADC data.</param>
+/// <param name="dmaFifoSize">How many entries the DMA buffer can hold, a power of two.</param>
+/// <param name="data">A pointer to a data structure used to store ADC data, dmaFifoSize
+/// entries, or one per channel with decimation, for every block.</param>
 /// <param name="rawData">A pointer to a data structure to contain the unformatted data.</param>
 /// <param name="channel"> Which ADC channels to use, this is a bit mask, so 0111 would
 /// enable ADC channels 0, 1 and 2.</param>
-/// <param name="frequency">Sets the the frequency at which the ADC block is run.</param>
+/// <param name="frequency">Sets the the frequency at which the ADC block is run, 0 for the
+/// configured frequency.</param>
 /// <param name="referenceVoltage">The reference voltage being used, either between 1.62V and 1.92V
 /// or between 2.25V and 2.75V. Defaults to setting for 1.8V between 1.92V and 2.25V. This parameter
 /// is scaled in millivolts, so for 1.8V pass 1800 and for 2.5V pass 2500.</param>
@@ -96,6 +251,17 @@ int32_t ADC_ReadPeriodicAsync(
     uint16_t channel, uint32_t frequency,
     uint16_t referenceVoltage);
 
+/// <summary>
+/// <para>ADC_ReadPeriodicAsync(), storing each value as a packed ADC_Sample. The interrupt
+/// handler packs the DMA FIFO words directly, so the data buffer takes 2 bytes per entry
+/// rather than 8.</para>
+/// </summary>
+int32_t ADC_ReadPeriodicPackedAsync(
+    AdcContext *handle, void (*callback)(int32_t status),
+    uint32_t dmaFifoSize, ADC_Sample *data, uint32_t *rawData,
+    uint16_t channel, uint32_t frequency,
+    uint16_t referenceVoltage);
+
 /// <summary>
 /// <para>Configures the appropriate ADC block and returns the requested ADC data synchronously.
 /// </para>
@@ -731,9 +731,11 @@ static void SPIMaster_IRQ(Platform_Unit unit)
         if (handle->csEnable && handle->csCallback) {
             handle->csCallback(handle, false);
         }
-        if (handle->callback) {
-            handle->callback(status, handle->dataCount);
-            handle->callback = NULL;
+        // Release the handle before the callback, so it can queue the next transfer.
+        void (*callback)(int32_t, uintptr_t) = handle->callback;
+        handle->callback = NULL;
+        if (callback) {
+            callback(status, handle->dataCount);
         }
     }
 }
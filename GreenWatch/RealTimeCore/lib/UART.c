@@ -13,10 +13,16 @@
 #undef UART_ALLOW_DMA
 
 
-// Configure these variables as needed.
+// Buffer sizes used by UART_Open, configure these variables as needed.
 #define TX_BUFFER_SIZE 256
 #define RX_BUFFER_SIZE 32
 
+// UART_Open draws its buffers from this pool, by default there's room for two units.
+// UART_OpenBuffered doesn't use the pool.
+#ifndef UART_POOL_SIZE
+#define UART_POOL_SIZE (2 * (TX_BUFFER_SIZE + RX_BUFFER_SIZE))
+#endif
+
 #if (TX_BUFFER_SIZE > 65536)
 #error "TX buffer size must be less than or equal 65536"
 #endif
@@ -34,14 +40,27 @@
 #endif
 
 
-// TODO: Reduce sysram usage by providing a more limited set of buffers?
-static __attribute__((section(".sysram"))) uint8_t UART_BuffRX[MT3620_UART_COUNT][RX_BUFFER_SIZE] = { 0 };
-static __attribute__((section(".sysram"))) uint8_t UART_BuffTX[MT3620_UART_COUNT][TX_BUFFER_SIZE] = { 0 };
+// A pool size of 0 leaves out the pool, UART_Open then always fails.
+#if UART_POOL_SIZE > 0
+static __attribute__((section(".sysram"))) uint8_t UART_Pool[UART_POOL_SIZE];
+static uint32_t UART_PoolUsed = 0;
+
+// Pool allocations are kept per unit, so closing and reopening a unit doesn't leak.
+static uint8_t *UART_PoolRX[MT3620_UART_COUNT] = { NULL };
+static uint8_t *UART_PoolTX[MT3620_UART_COUNT] = { NULL };
+#endif
+
+// Largest accepted difference between requested and actual baud rate [0.1 %].
+#define UART_MAX_BAUD_ERROR 20
 
 struct UART {
     bool     open;
     unsigned id;
     bool     dma;
+    unsigned baud;
+
+    uint8_t *txBuff, *rxBuff;
+    uint32_t txSize, rxSize;
 
     uint32_t txRemain, txRead, txWrite;
     uint32_t rxRemain, rxRead, rxWrite;
@@ -59,8 +78,83 @@ static inline unsigned UART_UnitToID(Platform_Unit unit)
     return (unit - MT3620_UNIT_UART_DEBUG);
 }
 
+typedef struct {
+    unsigned dl;
+    unsigned count;
+    unsigned fract;
+    unsigned baud;
+} UART_Divisor;
+
+// In high speed mode 3 a bit lasts dl * (count + (fract / 10)) UART clocks, where count is
+// the 8-bit sample count and fract the number of bits in a 10-bit frame which get an extra
+// sample.
+static bool UART_CalcDivisor(unsigned baud, UART_Divisor *div)
+{
+    if ((baud == 0) || (baud > MT3620_UART_MAX_SPEED)) {
+        return false;
+    }
+
+    // Bit period in tenths of a UART clock.
+    unsigned divs = ((MT3620_UART_CLOCK * 10) + (baud / 2)) / baud;
+
+    // Smallest divisor latch which keeps the sample count within 8 bits, it leaves the most
+    // resolution for the fraction.
+    unsigned dl = (divs + ((256 * 10) - 1)) / (256 * 10);
+    if (dl > 0xFFFF) {
+        return false;
+    }
+
+    unsigned tenths = (divs + (dl / 2)) / dl;
+    div->dl    = dl;
+    div->count = tenths / 10;
+    div->fract = tenths % 10;
+
+    // The sample point is placed mid bit, which needs at least 4 samples.
+    if (div->count < 4) {
+        return false;
+    }
+
+    unsigned period = dl * tenths;
+    div->baud = ((MT3620_UART_CLOCK * 10) + (period / 2)) / period;
+
+    unsigned error = (div->baud > baud ? (div->baud - baud) : (baud - div->baud));
+    return (((error * 1000) / baud) <= UART_MAX_BAUD_ERROR);
+}
+
+// Must be called with LCR.DLAB set.
+static void UART_WriteDivisor(unsigned id, const UART_Divisor *div)
+{
+    unsigned fract = mt3620_uart_fract_lut[div->fract];
+
+    MT3620_UART_FIELD_WRITE(id, highspeed, speed, 3);
+    MT3620_UART_FIELD_WRITE(id, dlm, dlm, (div->dl >> 8)); // Divisor Latch (MS)
+    MT3620_UART_FIELD_WRITE(id, dll, dll, (div->dl & 0xFF)); // Divisor Latch (LS)
+    MT3620_UART_FIELD_WRITE(id, sample_count, sample_count, (div->count - 1));
+    MT3620_UART_FIELD_WRITE(id, sample_point, sample_point, ((div->count / 2) - 2));
+    MT3620_UART_FIELD_WRITE(id, fracdiv_m, fracdiv_m, (fract >> 8));
+    MT3620_UART_FIELD_WRITE(id, fracdiv_l, fracdiv_l, (fract & 0xFF));
+}
+
+static inline bool UART_BufferSizeValid(uint32_t size)
+{
+    return (size > 0) && (size <= 65536) && ((size & (size - 1)) == 0);
+}
+
+#if UART_POOL_SIZE > 0
+static uint8_t *UART_PoolAlloc(uint32_t size)
+{
+    if ((UART_POOL_SIZE - UART_PoolUsed) < size) {
+        return NULL;
+    }
+    uint8_t *buff = &UART_Pool[UART_PoolUsed];
+    UART_PoolUsed += size;
+    return buff;
+}
+#endif
+
 UART *UART_Open(Platform_Unit unit, unsigned baud, UART_Parity parity, unsigned stopBits, void (*rxCallback)(void))
 {
+#if UART_POOL_SIZE > 0
     unsigned id = UART_UnitToID(unit);
     if (id >= MT3620_UART_COUNT) {
         return NULL;
@@ -70,25 +164,53 @@ UART *UART_Open(Platform_Unit unit, unsigned baud, UART_Parity parity, unsigned
         return NULL;
     }
 
-    if (baud > MT3620_UART_MAX_SPEED) {
+    if (!UART_PoolRX[id]) {
+        UART_PoolRX[id] = UART_PoolAlloc(RX_BUFFER_SIZE);
+    }
+    if (!UART_PoolTX[id]) {
+        UART_PoolTX[id] = UART_PoolAlloc(TX_BUFFER_SIZE);
+    }
+    if (!UART_PoolRX[id] || !UART_PoolTX[id]) {
         return NULL;
     }
 
-    if (parity > UART_PARITY_STICK_ONE) {
+    return UART_OpenBuffered(unit, baud, parity, stopBits, rxCallback,
+        UART_PoolRX[id], RX_BUFFER_SIZE, UART_PoolTX[id], TX_BUFFER_SIZE);
+#else
+    return NULL;
+#endif
+}
+
+UART *UART_OpenBuffered(
+    Platform_Unit unit, unsigned baud, UART_Parity parity, unsigned stopBits, void (*rxCallback)(void),
+    void *rxBuffer, uint32_t rxSize, void *txBuffer, uint32_t txSize)
+{
+    unsigned id = UART_UnitToID(unit);
+    if (id >= MT3620_UART_COUNT) {
         return NULL;
     }
 
-    if ((stopBits < 1) || (stopBits > 2)) {
+    if (context[id].open) {
         return NULL;
     }
 
-    unsigned divs  = ((MT3620_UART_CLOCK * 10) + (baud / 2)) / baud;
+    if (!rxBuffer || !txBuffer
+        || !UART_BufferSizeValid(rxSize) || !UART_BufferSizeValid(txSize)) {
+        return NULL;
+    }
 
-    unsigned dl;
-    for (dl = 1; divs > (256 * 10); dl++, divs >>= 1);
+    UART_Divisor div;
+    if (!UART_CalcDivisor(baud, &div)) {
+        return NULL;
+    }
 
-    unsigned fract = mt3620_uart_fract_lut[divs % 10];
-    unsigned count = (divs / 10);
+    if (parity > UART_PARITY_STICK_ONE) {
+        return NULL;
+    }
+
+    if ((stopBits < 1) || (stopBits > 2)) {
+        return NULL;
+    }
 
     // LCR (enable DLL, DLM)
     mt3620_uart_lcr_t lcr = { .mask = mt3620_uart[id]->lcr };
@@ -109,13 +231,7 @@ UART *UART_Open(Platform_Unit unit, unsigned baud, UART_Parity parity, unsigned
     efr.auto_cts     = 0;
     mt3620_uart[id]->efr = efr.mask;
 
-    MT3620_UART_FIELD_WRITE(id, highspeed, speed, 3);
-    MT3620_UART_FIELD_WRITE(id, dlm, dlm, (dl >> 8)); // Divisor Latch (MS)
-    MT3620_UART_FIELD_WRITE(id, dll, dll, (dl & 0xFF)); // Divisor Latch (LS)
-    MT3620_UART_FIELD_WRITE(id, sample_count, sample_count, (count - 1));
-    MT3620_UART_FIELD_WRITE(id, sample_point, sample_point, ((count / 2) - 2));
-    MT3620_UART_FIELD_WRITE(id, fracdiv_m, fracdiv_m, (fract >> 8));
-    MT3620_UART_FIELD_WRITE(id, fracdiv_l, fracdiv_l, (fract & 0xFF));
+    UART_WriteDivisor(id, &div);
 
     // LCR (8-bit word length)
     lcr.wls  = 3;
@@ -152,8 +268,8 @@ UART *UART_Open(Platform_Unit unit, unsigned baud, UART_Parity parity, unsigned
 
         volatile mt3620_dma_t * const tx_dma = &mt3620_dma[MT3620_UART_DMA_TX(id)];
         tx_dma->fixaddr = (void *)&mt3620_uart[id]->thr;
-        tx_dma->pgmaddr = (void *)UART_BuffTX[id];
-        tx_dma->ffsize  = TX_BUFFER_SIZE;
+        tx_dma->pgmaddr = txBuffer;
+        tx_dma->ffsize  = txSize;
         tx_dma->count   = 0;
 
         mt3620_dma_con_t dma_con_tx = { .mask = tx_dma->con };
@@ -171,8 +287,8 @@ UART *UART_Open(Platform_Unit unit, unsigned baud, UART_Parity parity, unsigned
 
         volatile mt3620_dma_t * const rx_dma = &mt3620_dma[MT3620_UART_DMA_RX(id)];
         rx_dma->fixaddr = (void *)&mt3620_uart[id]->thr;
-        rx_dma->pgmaddr = (void *)UART_BuffRX[id];
-        rx_dma->ffsize  = RX_BUFFER_SIZE;
+        rx_dma->pgmaddr = rxBuffer;
+        rx_dma->ffsize  = rxSize;
         rx_dma->count = 0;
 
         mt3620_dma_con_t dma_con_rx = { .mask = rx_dma->con };
@@ -208,12 +324,18 @@ UART *UART_Open(Platform_Unit unit, unsigned baud, UART_Parity parity, unsigned
     context[id].id   = id;
     context[id].open = true;
     context[id].dma  = dma;
+    context[id].baud = div.baud;
 
-    context[id].txRemain = TX_BUFFER_SIZE;
+    context[id].txBuff = txBuffer;
+    context[id].txSize = txSize;
+    context[id].rxBuff = rxBuffer;
+    context[id].rxSize = rxSize;
+
+    context[id].txRemain = txSize;
     context[id].txRead   = 0;
     context[id].txWrite  = 0;
 
-    context[id].rxRemain = RX_BUFFER_SIZE;
+    context[id].rxRemain = rxSize;
     context[id].rxRead   = 0;
     context[id].rxWrite  = 0;
 
@@ -267,14 +389,12 @@ int32_t UART_Write(UART *handle, const void *data, uintptr_t size)
 
             uintptr_t i;
             for (i = 0; i < chunk; i++) {
-                UART_BuffTX[handle->id][tx_dma->swptr++] = ((const uint8_t *)data)[i];
-#if (TX_BUFFER_SIZE < 65536)
+                handle->txBuff[tx_dma->swptr++ & 0xFFFF] = ((const uint8_t *)data)[i];
                 // When the buffer isn't exactly 16-bits we need to handle the wrap bit.
-                if ((tx_dma->swptr & 0xFFFF) > TX_BUFFER_SIZE) {
+                if ((handle->txSize < 65536) && ((tx_dma->swptr & 0xFFFF) >= handle->txSize)) {
                     tx_dma->swptr &= 0xFFFF0000;
                     tx_dma->swptr ^= 0x00010000;
                 }
-#endif
             }
 
             MT3620_DMA_FIELD_WRITE(MT3620_UART_DMA_TX(handle->id), start, str, true);
@@ -284,7 +404,7 @@ int32_t UART_Write(UART *handle, const void *data, uintptr_t size)
         }
     } else {
         // If nothing is queued in hardware, queue that first.
-        if ((handle->txRemain == TX_BUFFER_SIZE)
+        if ((handle->txRemain == handle->txSize)
             && MT3620_UART_FIELD_READ(handle->id, lsr, thre)) {
             uint32_t offset = MT3620_UART_FIELD_READ(handle->id, tx_offset, tx_offset);
             uint32_t remain = MT3620_UART_TX_FIFO_DEPTH - offset;
@@ -311,8 +431,8 @@ int32_t UART_Write(UART *handle, const void *data, uintptr_t size)
             // We can't use memcpy here because the buffer wraps.
             uint32_t i;
             for (i = 0; i < chunk; i++) {
-                UART_BuffTX[handle->id][handle->txWrite++] = ((const uint8_t *)data)[i];
-                handle->txWrite %= TX_BUFFER_SIZE;
+                handle->txBuff[handle->txWrite++] = ((const uint8_t *)data)[i];
+                handle->txWrite &= (handle->txSize - 1);
             }
             handle->txRemain -= chunk;
 
@@ -354,14 +474,12 @@ int32_t UART_Read(UART *handle, void *data, uintptr_t size)
 
             uintptr_t i;
             for (i = 0; i < chunk; i++) {
-                ((uint8_t *)data)[i] = UART_BuffRX[handle->id][rx_dma->swptr++];
-#if (RX_BUFFER_SIZE < 65536)
+                ((uint8_t *)data)[i] = handle->rxBuff[rx_dma->swptr++ & 0xFFFF];
                 // When the buffer isn't exactly 16-bits we need to handle the wrap bit.
-                if ((rx_dma->swptr & 0xFFFF) > RX_BUFFER_SIZE) {
+                if ((handle->rxSize < 65536) && ((rx_dma->swptr & 0xFFFF) >= handle->rxSize)) {
                     rx_dma->swptr &= 0xFFFF0000;
                     rx_dma->swptr ^= 0x00010000;
                 }
-#endif
             }
 
             MT3620_DMA_FIELD_WRITE(MT3620_UART_DMA_RX(handle->id), start, str, true);
@@ -371,14 +489,14 @@ int32_t UART_Read(UART *handle, void *data, uintptr_t size)
         }
     } else {
         while (size > 0) {
-            uintptr_t avail = RX_BUFFER_SIZE - handle->rxRemain;
+            uintptr_t avail = handle->rxSize - handle->rxRemain;
 
             uintptr_t chunk = (avail > size ? size : avail);
 
             uintptr_t i;
             for (i = 0; i < chunk; i++) {
-                ((uint8_t *)data)[i] = UART_BuffRX[handle->id][handle->rxRead++];
-                handle->rxRead %= RX_BUFFER_SIZE;
+                ((uint8_t *)data)[i] = handle->rxBuff[handle->rxRead++];
+                handle->rxRead &= (handle->rxSize - 1);
             }
             handle->rxRemain += chunk;
 
@@ -403,10 +521,92 @@ uintptr_t UART_ReadAvailable(UART *handle)
     if (handle->dma) {
         return mt3620_dma[MT3620_UART_DMA_RX(handle->id)].ffcnt;
     } else {
-        return (RX_BUFFER_SIZE - handle->rxRemain);
+        return (handle->rxSize - handle->rxRemain);
+    }
+}
+
+uintptr_t UART_WriteAvailable(UART *handle)
+{
+    if (!handle || !handle->open) {
+        return 0;
+    }
+
+    if (handle->dma) {
+        volatile mt3620_dma_t * const tx_dma = &mt3620_dma[MT3620_UART_DMA_TX(handle->id)];
+        return (tx_dma->ffsize - tx_dma->ffcnt);
+    } else {
+        return handle->txRemain;
     }
 }
 
+int32_t UART_SetBaud(UART *handle, unsigned baud)
+{
+    if (!handle) {
+        return ERROR_PARAMETER;
+    }
+
+    if (!handle->open) {
+        return ERROR_HANDLE_CLOSED;
+    }
+
+    UART_Divisor div;
+    if (!UART_CalcDivisor(baud, &div)) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    mt3620_uart_lcr_t lcr = { .mask = mt3620_uart[handle->id]->lcr };
+    lcr.dlab = true;
+    mt3620_uart[handle->id]->lcr = lcr.mask;
+
+    UART_WriteDivisor(handle->id, &div);
+
+    lcr.dlab = false;
+    mt3620_uart[handle->id]->lcr = lcr.mask;
+
+    handle->baud = div.baud;
+    return ERROR_NONE;
+}
+
+unsigned UART_GetBaud(UART *handle)
+{
+    if (!handle || !handle->open) {
+        return 0;
+    }
+    return handle->baud;
+}
+
+int32_t UART_SetLoopback(UART *handle, bool enable)
+{
+    if (!handle) {
+        return ERROR_PARAMETER;
+    }
+
+    if (!handle->open) {
+        return ERROR_HANDLE_CLOSED;
+    }
+
+    MT3620_UART_FIELD_WRITE(handle->id, mcr, loop, enable);
+    return ERROR_NONE;
+}
+
+bool UART_WriteIdle(UART *handle)
+{
+    if (!handle || !handle->open) {
+        return true;
+    }
+
+    if (handle->dma) {
+        if (mt3620_dma[MT3620_UART_DMA_TX(handle->id)].ffcnt != 0) {
+            return false;
+        }
+    } else if (handle->txRemain != handle->txSize) {
+        return false;
+    }
+
+    // Transmitter empty, including the shift register.
+    return MT3620_UART_FIELD_READ(handle->id, lsr, temt);
+}
+
 static void UART_HandleIRQ(Platform_Unit unit)
 {
     unsigned id = UART_UnitToID(unit);
@@ -433,13 +633,13 @@ static void UART_HandleIRQ(Platform_Unit unit)
             uint32_t remain = MT3620_UART_TX_FIFO_DEPTH - offset;
 
             uint32_t i;
-            for (i = 0; (i < remain) && (handle->txRemain < TX_BUFFER_SIZE); i++, handle->txRemain++) {
-                mt3620_uart[id]->thr = UART_BuffTX[id][handle->txRead++];
-                handle->txRead %= TX_BUFFER_SIZE;
+            for (i = 0; (i < remain) && (handle->txRemain < handle->txSize); i++, handle->txRemain++) {
+                mt3620_uart[id]->thr = handle->txBuff[handle->txRead++];
+                handle->txRead &= (handle->txSize - 1);
             }
 
             // If sent all enqueued data then disable TX interrupt.
-            if (handle->txRemain == TX_BUFFER_SIZE) {
+            if (handle->txRemain == handle->txSize) {
                 // Interrupt Enable Register
                 MT3620_UART_FIELD_WRITE(handle->id, ier, etbei, false);
             }
@@ -451,8 +651,8 @@ static void UART_HandleIRQ(Platform_Unit unit)
         case MT3620_UART_IIR_ID_RX_DATA_RECEIVED:
             if (!handle->dma) {
                 for (; (handle->rxRemain > 0) && MT3620_UART_FIELD_READ(handle->id, lsr, dr); handle->rxRemain--) {
-                    UART_BuffRX[id][handle->rxWrite++] = MT3620_UART_FIELD_READ(handle->id, rbr, rbr);
-                    handle->rxWrite %= RX_BUFFER_SIZE;
+                    handle->rxBuff[handle->rxWrite++] = MT3620_UART_FIELD_READ(handle->id, rbr, rbr);
+                    handle->rxWrite &= (handle->rxSize - 1);
                 }
             }
 
@@ -6,6 +6,7 @@
 
 #include "Platform.h"
 #include "Common.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 
@@ -41,6 +42,25 @@ static const uint32_t UART_PRIORITY = 2;
 /// application should call <see cref="UART_DequeueData" /> to retrieve the data.</param>
 UART *UART_Open(Platform_Unit unit, unsigned baud, UART_Parity parity, unsigned stopBits, void (*rxCallback)(void));
 
+/// <summary>
+/// <para>Same as <see cref="UART_Open" />, but uses caller supplied buffers instead of the
+/// default sized ones <see cref="UART_Open" /> takes from a shared pool. The buffers must stay
+/// valid until the UART is closed and must be in SYSRAM if the UART uses DMA.</para>
+/// </summary>
+/// <param name="unit">Which UART to initialize.</param>
+/// <param name="baud">Target baud rate.</param>
+/// <param name="parity">Parity mode: <see cref="UART_Parity" />.</param>
+/// <param name="stopBits">Number of stop bits, only 1 or 2 are valid.</param>
+/// <param name="rxCallback">An optional callback to invoke when the UART receives data.</param>
+/// <param name="rxBuffer">Receive buffer.</param>
+/// <param name="rxSize">Receive buffer size, a power of two up to 65536.</param>
+/// <param name="txBuffer">Transmit buffer.</param>
+/// <param name="txSize">Transmit buffer size, a power of two up to 65536.</param>
+/// <returns>A handle, or NULL if the UART is already open or a parameter is invalid.</returns>
+UART *UART_OpenBuffered(
+    Platform_Unit unit, unsigned baud, UART_Parity parity, unsigned stopBits, void (*rxCallback)(void),
+    void *rxBuffer, uint32_t rxSize, void *txBuffer, uint32_t txSize);
+
 /// <summary>
 /// <para>Releases a handle once it's finished using a given UART interface. 
 /// Once released the handle is free to be opened again.</para>
@@ -51,7 +71,7 @@ void UART_Close(UART *handle);
 /// <summary>
 /// <para>Buffers the supplied data and asynchronously writes it to the supplied UART.
 /// If there is not enough space to buffer the data, then any unbuffered data will be discarded.
-/// The size of the buffer is defined by the TX_BUFFER_SIZE macro in UART.c.</para>
+/// The size of the buffer is set when the UART is opened.</para>
 /// <para>To send a null-terminated string, call <see cref="Uart_EnqueueString" />.
 /// To send an integer call <see cref="UART_EnqueueIntegerAsString" /> or
 /// <see cref="UART_EnqueueIntegerAsHexString"/>.</para>
@@ -78,4 +98,46 @@ int32_t UART_Read(UART *handle, void *data, uintptr_t size);
 /// <returns>Number of bytes available to be read.</returns>
 uintptr_t UART_ReadAvailable(UART *handle);
 
+/// <summary>
+/// This function returns the number of bytes which can be written to a UART without blocking.
+/// </summary>
+/// <param name="handle">Which UART to query the write buffer space of.</param>
+/// <returns>Number of bytes which can be buffered.</returns>
+uintptr_t UART_WriteAvailable(UART *handle);
+
+/// <summary>
+/// <para>Changes the baud rate of an open UART. Wait for <see cref="UART_WriteIdle" /> first,
+/// bytes in flight are corrupted otherwise.</para>
+/// </summary>
+/// <param name="handle">Which UART to configure.</param>
+/// <param name="baud">Target baud rate, up to 3000000.</param>
+/// <returns>ERROR_NONE on success, ERROR_UNSUPPORTED if the rate can't be generated within
+/// 2 %, or another error code.</returns>
+int32_t UART_SetBaud(UART *handle, unsigned baud);
+
+/// <summary>
+/// <para>Returns the baud rate actually generated for a UART, which may differ slightly from
+/// the requested one.</para>
+/// </summary>
+/// <param name="handle">Which UART to query.</param>
+/// <returns>Baud rate, or 0 if the handle isn't open.</returns>
+unsigned UART_GetBaud(UART *handle);
+
+/// <summary>
+/// <para>Enables or disables internal loopback. While enabled, transmitted bytes are received
+/// by the same UART and the TX line stays idle.</para>
+/// </summary>
+/// <param name="handle">Which UART to configure.</param>
+/// <param name="enable">True to enable loopback.</param>
+/// <returns>ERROR_NONE on success, or an error code.</returns>
+int32_t UART_SetLoopback(UART *handle, bool enable);
+
+/// <summary>
+/// <para>Returns true once all buffered data, including the last byte in the shift register,
+/// has been sent.</para>
+/// </summary>
+/// <param name="handle">Which UART to query.</param>
+/// <returns>True if the transmitter is idle.</returns>
+bool UART_WriteIdle(UART *handle);
+
 #endif // #ifndef MT3620_UART_H_
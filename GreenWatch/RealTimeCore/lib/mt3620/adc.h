@@ -23,6 +23,9 @@
 
 #define MT3620_ADC_COUNT 1
 
+//Number of ADC input channels, as selected by reg_ch_map
+#define MT3620_ADC_CHANNEL_COUNT 8
+
 //V_ref ranges for RG_AUXADC[31] (vcm_azure_en)
 #define ADC_VREF_1V8_MAX 1980
 #define ADC_VREF_1V8_MIN 1620
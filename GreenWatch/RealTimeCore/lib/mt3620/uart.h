@@ -508,6 +508,7 @@ static const uint16_t mt3620_uart_fract_lut[10] = {
     0b0001001001,
     0b0010100101,
     0b0101010101,
+    0b0101101101,
     0b0110110111,
     0b0111101111,
     0b0111111111,
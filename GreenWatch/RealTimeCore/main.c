@@ -3,7 +3,6 @@
 #include <stdint.h>
 #include <stdlib.h>
 
-#include "lib/CPUFreq.h"
 #include "lib/VectorTable.h"
 #include "lib/NVIC.h"
 #include "lib/GPIO.h"
@@ -17,193 +16,312 @@
 #include "resources/LPS22HH.h"
 #include "resources/ui_msg.h"
 #include "resources/utilities.h"
+#include "resources/logger.h"
+#include "resources/telemetry.h"
+#include "resources/cmd.h"
+#include "resources/rollup.h"
+#include "resources/sample_log.h"
+#include "resources/flash_log.h"
+#include "resources/stats.h"
+#include "resources/channels.h"
+#include "resources/dli.h"
+#include "resources/scheduler.h"
+#include "resources/governor.h"
 
 #define STARTUP_RETRY_COUNT  20
 #define STARTUP_RETRY_PERIOD 500 // [ms]
 
 static GPT* startUpTimer = NULL;
-static GPT* samplingTimer = NULL;
+static GPT* clockTimer = NULL;
+static GPT* wakeupTimer = NULL;
 
 UART* uart_m4_debug = NULL;
 static UART* uart_ui = NULL;
 
+// The debug UART gets a large TX buffer so bursts of log frames don't block, the UI UART
+// enough RX for a full command line.
+static SYSRAM_DATA uint8_t uartDebugRx[32];
+static SYSRAM_DATA uint8_t uartDebugTx[4096];
+static SYSRAM_DATA uint8_t uartUiRx[256];
+static SYSRAM_DATA uint8_t uartUiTx[1024];
+
 I2CMaster* driver = NULL;
 
-static __attribute__((section(".sysram"))) uint32_t rawData[ADC_DATA_SIZE];
-ADC_Data lightData[ADC_DATA_SIZE];
-static int32_t adcStatus;
+// The ADC scans channels 0 to 3 ADC_SCAN_RATE times per second into a DMA FIFO, every FIFO
+// entry being the hardware average of 16 conversions. The interrupt handler averages
+// ADC_DECIMATION scans into each value of a block; the 12 scans fill 48 of the 64 FIFO
+// entries, which raises the FIFO interrupt, about 5 times per second with one block each.
+#define ADC_CHANNEL_MASK 0xF
+#define ADC_FIFO_SIZE    64
+#define ADC_SCAN_RATE    64
+#define ADC_DECIMATION   12
+#define ADC_VREF         2500
+
+static const ADC_Config adcConfig = {
+	.referenceVoltage = ADC_VREF,
+	.averaging        = ADC_AVERAGE_16,
+	.channelTime      = 8,
+	.initTime         = 20,
+	.frequency        = ADC_SCAN_RATE,
+};
+
+// The driver fills one block of averages while the main loop keeps the newest complete one
+// in adcData and hands the older ones back, with one spare block to absorb a late main loop.
+#define ADC_BLOCKS 3
+
+static SYSRAM_DATA uint32_t rawData[ADC_FIFO_SIZE];
+static ADC_Sample adcBlocks[ADC_BLOCKS][ADC_DATA_SIZE];
+static const ADC_Sample adcNoData[ADC_DATA_SIZE] = { 0 };
+static AdcContext* adc = NULL;
+const ADC_Sample* adcData = adcNoData;
+
+static currentMenu menu = { 0, 0, NULL, NULL, false };
+
+bool telemetryStream = false;
+uint8_t sampleInterval = 2;
 
-static currentMenu menu = { 0, 0, NULL, false };
+// Latest logged samples of every channel, see resources/channels.h.
+SYSRAM_DATA SampleTable sampleTable;
 
-static bool samplingTimeFlag = false;
-uint8_t sampleInterval = 2;
+// Long term history of the logged samples, in the same raw units as the table.
+SYSRAM_DATA Rollup_Store sampleTrend[CHANNEL_COUNT];
 
-ringBuffer_int16 temperatureLog;
-ringBuffer_uint32 pressureLog;
-ringBuffer_uint32 lightLog;
+// Every logged sample, delta encoded, for the history and export commands.
+SYSRAM_DATA SampleLog_Store sampleHistory;
 
-static bool logResize = false;
-uint8_t logSize = 5;
+// Running statistics of every logged sample since boot.
+Stats_Channel sampleStats[CHANNEL_COUNT];
 
-typedef struct CallbackNode {
-	bool enqueued;
-	struct CallbackNode* next;
-	void (*cb)(void);
-} CallbackNode;
+// Number of logged samples shown by the UI, at most SAMPLE_LOG_CAPACITY.
+uint8_t logSize = 5;
 
-static CallbackNode* volatile callbacks = NULL;
+// Daily light integral of every ADC block, counted in ADC scans.
+Dli_Store lightDli;
+static uint32_t lightPpfd = 0;
 
-static void EnqueueCallback(CallbackNode* node)
+static void callbackADCDeferred(void)
 {
-	uint32_t prevBasePri = NVIC_BlockIRQs();
-	if (!node->enqueued) {
-		CallbackNode* prevHead = callbacks;
-		node->enqueued = true;
-		callbacks = node;
-		node->next = prevHead;
-	}
-	NVIC_RestoreIRQs(prevBasePri);
+	static uint32_t overrunScans = 0;
+
+	// Blocks are weighted by the scans they cover. Dropped ones count as the last reading, so
+	// the light integral keeps time.
+	uint32_t dropped = ADC_GetOverrunScans(adc) - overrunScans;
+	overrunScans += dropped;
+	Dli_Add(&lightDli, lightPpfd, dropped);
+
+	// The block in adcData is counted already, it's handed back once a newer one is ready.
+	bool held = (adcData != adcNoData);
+	while (ADC_BlocksReady(adc) > (held ? 1 : 0)) {
+		if (held) {
+			ADC_ReleaseBlock(adc);
+		}
+		ADC_Sample* block = ADC_GetPackedBlock(adc, NULL);
+		if (!block) {
+			break;
+		}
+		adcData = block;
+		held = true;
+
+		lightPpfd = Light_LuxToPpfd(Light_ToLux(ADC_SAMPLE_VALUE(block[ADC_CHANNEL_LIGHT])));
+		Dli_Add(&lightDli, lightPpfd, ADC_GetBlockScans(adc));
+	}
 }
 
 static void callbackADC(int32_t status)
 {
-	adcStatus = status;
+	static CallbackNode cbn = { .enqueued = false, .cb = callbackADCDeferred };
+	Scheduler_Enqueue(&cbn);
 }
 
-static void callbackSamplingTimer(int32_t status)
+static void SendDliRecord(uint32_t number, bool closed, const Dli_Day* day)
 {
-	samplingTimeFlag = true;
+	Telemetry_Dli record = {
+		.type        = TELEMETRY_RECORD_DLI,
+		.day         = (uint16_t)number,
+		.closed      = closed ? 1 : 0,
+		.integral    = day->integral,
+		.photoperiod = day->photoperiod,
+		.onset       = day->onset,
+	};
+	Telemetry_Send(uart_ui, &record, sizeof(record));
 }
 
-static void HandleUartIsu0RxIrqDeferred(void)
+// Bounds the idle wait by the flash log and export work, see Scheduler_SetIdleLimit().
+static uint32_t WorkIdleLimit(void)
 {
-	uintptr_t avail = UART_ReadAvailable(uart_ui);
-	if (avail == 0) {
-		UART_Print(uart_m4_debug, "ERROR: UART received interrupt for zero bytes.\r\n");
-		return;
-	}
+	return Cmd_Pending() ? 0 : FlashLog_IdleLimit();
+}
 
-	if (avail >= 65536) {
-		// Avoid handling large amounts of data as this could cause stack issues.
-		UART_Print(uart_m4_debug, "ERROR: UART received too many bytes.\r\n");
-		return;
-	}
+static bool SettingsValuePending(void)
+{
+	return (menu.mainMenu == 8) && (menu.subMenu != 0);
+}
 
-	uint8_t buffer[avail];
-	if (UART_Read(uart_ui, buffer, avail) != ERROR_NONE) {
-		UART_Print(uart_m4_debug, "ERROR: Failed to read ");
-		UART_PrintUInt(uart_m4_debug, avail);
-		UART_Print(uart_m4_debug, " bytes from UART.\r\n");
-		return;
+static XIP_CODE void ApplySettingsValue(const char* line)
+{
+	uint8_t numBuffer = atoi(line);
+	if (menu.subMenu == 1) {
+		// Change logging interval
+		sampleInterval = numBuffer > 0 ? numBuffer : sampleInterval;
 	}
+	if (menu.subMenu == 2) {
+		// Change log size
+		logSize = (numBuffer <= SAMPLE_LOG_CAPACITY && numBuffer > 0) ? numBuffer : logSize;
+	}
+	if (menu.subMenu == 3) {
+		// Change debug verbosity, entered as <module><level>
+		Logger_SetLevel(numBuffer / 10, numBuffer % 10);
+	}
+	menu.subMenu = 0;
+}
 
-
+// Single key menu navigation, returns false if the key isn't a menu key on this screen.
+static XIP_CODE bool HandleMenuKey(uint8_t key)
+{
+	// YOU ARE STREAMING TELEMETRY \/
+	if (telemetryStream) {
+		if (key == 0x58 || key == 0x78) {
+			telemetryStream = false;
+			menu.subMenu = 0;
+			menu.mainMenu = 0;
+			return true;
+		}
+		return false;
+	}
 
 	// YOU ARE IN ONE OF MAIN CATEGORIES \/
 	if (menu.mainMenu != 0) {
 		// YOU ARE IN THE SETTINGS \/
 		if (menu.mainMenu == 8) {
-			if (menu.subMenu == 0) {
-				switch (buffer[0])
-				{
-				case 0x31:
-
-					menu.subMenu = 1;
-					break;
-				case 0x32:
-					menu.subMenu = 2;
-					break;
-				case 0x58:							// X
-				case 0x78:							// x
-					menu.subMenu = 0;
-					menu.mainMenu = 0;
-					break;
-				default:
-					break;
-				}
-			}
-			else {
-				uint8_t numBuffer = atoi((char*)buffer);
-				if (menu.subMenu == 1) {
-					// Change logging interval
-					sampleInterval = numBuffer > 0 ? numBuffer : sampleInterval;
-				}
-				if (menu.subMenu == 2) {
-					// Change log size
-					logSize = (numBuffer <= MAX_BUFFER_SIZE && numBuffer > 0) ? numBuffer : logSize;
-					logResize = true;
-				}
+			switch (key)
+			{
+			case 0x31:
+				menu.subMenu = 1;
+				return true;
+			case 0x32:
+				menu.subMenu = 2;
+				return true;
+			case 0x33:
+				menu.subMenu = 3;
+				return true;
+			case 0x58:							// X
+			case 0x78:							// x
 				menu.subMenu = 0;
+				menu.mainMenu = 0;
+				return true;
+			default:
+				return false;
 			}
 		}
 		// YOU ARE IN DISPLAY CATEGORY \/
-		else {
-			if (buffer[0] == 0x58 || buffer[0] == 0x78) {
-				menu.subMenu = 0;
-				menu.mainMenu = 0;
-			}
-		};
+		if (key == 0x58 || key == 0x78) {
+			menu.subMenu = 0;
+			menu.mainMenu = 0;
+			return true;
+		}
+		return false;
 	}
+
 	// YOU ARE IN THE MAIN SCREEN \/
-	else {
-		switch (buffer[0])
-		{
-		case 0x31:
-			menu.mainMenu = 1;
-			break;
-		case 0x32:
-			menu.mainMenu = 2;
-			break;
-		case 0x33:
-			menu.mainMenu = 3;
-			break;
-		case 0x34:
-			menu.mainMenu = 4;
-			break;
-		case 0x35:
-			menu.mainMenu = 5;
-			break;
-		case 0x36:
-			menu.mainMenu = 6;
-			break;
-		case 0x37:
-			menu.mainMenu = 7;
-			break;
-		case 0x38:
-			menu.mainMenu = 8;
-			break;
-		default:
-			break;
-		}
+	switch (key)
+	{
+	case 0x31:
+		menu.mainMenu = 1;
+		return true;
+	case 0x32:
+		menu.mainMenu = 2;
+		return true;
+	case 0x33:
+		menu.mainMenu = 3;
+		return true;
+	case 0x34:
+		menu.mainMenu = 4;
+		return true;
+	case 0x35:
+		menu.mainMenu = 5;
+		return true;
+	case 0x36:
+		menu.mainMenu = 6;
+		return true;
+	case 0x37:
+		menu.mainMenu = 7;
+		return true;
+	case 0x38:
+		menu.mainMenu = 8;
+		return true;
+	case 0x39:
+		// Switch to binary telemetry, the menu is redrawn on exit
+		UART_ClearTerminal(uart_ui);
+		telemetryStream = true;
+		return true;
+	default:
+		return false;
 	}
-	updateMenuCallback(&menu);
 }
 
-static void HandleUartIsu0RxIrq(void) {
-	static CallbackNode cbn = { .enqueued = false, .cb = HandleUartIsu0RxIrqDeferred };
-	EnqueueCallback(&cbn);
+static void HandleUiByte(uint8_t c)
+{
+	// Menu keys act immediately, unless they're part of a command or a settings value.
+	if (Cmd_LineEmpty() && !SettingsValuePending() && HandleMenuKey(c)) {
+		updateMenuCallback(&menu);
+		return;
+	}
+
+	// Nothing but telemetry frames may go out while streaming.
+	UART* out = telemetryStream ? NULL : uart_ui;
+	char* line = Cmd_LineAppend(out, c);
+	if (!line) {
+		return;
+	}
+
+	if (SettingsValuePending()) {
+		ApplySettingsValue(line);
+		updateMenuCallback(&menu);
+		return;
+	}
+
+	bool wasStreaming = telemetryStream;
+	Cmd_Execute(out, line);
+	if (wasStreaming && !telemetryStream) {
+		menu.subMenu = 0;
+		menu.mainMenu = 0;
+		updateMenuCallback(&menu);
+	}
 }
 
-static void InvokeCallbacks(void)
+static void HandleUartIsu0RxIrqDeferred(void)
 {
-	CallbackNode* node;
-	do {
-		uint32_t prevBasePri = NVIC_BlockIRQs();
-		node = callbacks;
-		if (node) {
-			node->enqueued = false;
-			callbacks = node->next;
+	static uint8_t buffer[32];
+
+	uintptr_t avail;
+	while ((avail = UART_ReadAvailable(uart_ui)) > 0) {
+		if (avail > sizeof(buffer)) {
+			avail = sizeof(buffer);
+		}
+
+		if (UART_Read(uart_ui, buffer, avail) != ERROR_NONE) {
+			LOG_ERROR(LOG_MODULE_UI, "ERROR: Failed to read %u bytes from UART.\r\n", (uint32_t)avail);
+			return;
 		}
-		NVIC_RestoreIRQs(prevBasePri);
 
-		if (node) {
-			(*node->cb)();
+		uintptr_t i;
+		for (i = 0; i < avail; i++) {
+			HandleUiByte(buffer[i]);
 		}
-	} while (node);
+	}
 }
 
-static void displaySensors_LSM()
+static void HandleUartIsu0RxIrq(void) {
+	static CallbackNode cbn = { .enqueued = false, .cb = HandleUartIsu0RxIrqDeferred };
+	Scheduler_Enqueue(&cbn);
+}
+
+static XIP_CODE void displaySensors_LSM()
 {
+	if (!Logger_Enabled(LOG_MODULE_LSM6DSO, LOG_LEVEL_DEBUG)) {
+		return;
+	}
+
 	bool hasXL = false, hasG = false, hasTemp = false;
 
 	// Wait for sensor board to be ready
@@ -212,7 +330,7 @@ static void displaySensors_LSM()
 	uint32_t retryRemain = STARTUP_RETRY_COUNT;
 	while (retryRemain > 0) {
 		if (!LSM6DSO_Status(driver, &hasTemp, &hasG, &hasXL)) {
-			UART_Print(uart_m4_debug, "ERROR: Failed to read accelerometer status register.\r\n");
+			LOG_ERROR(LOG_MODULE_LSM6DSO, "ERROR: Failed to read accelerometer status register.\r\n");
 		}
 		if (hasTemp && hasG && hasXL) {
 			initialised = true;
@@ -220,7 +338,7 @@ static void displaySensors_LSM()
 		}
 		if ((error = GPT_WaitTimer_Blocking(
 			startUpTimer, 500, GPT_UNITS_MILLISEC)) != ERROR_NONE) {
-			UART_Printf(uart_m4_debug, "ERROR: Failed to start blocking wait (%ld).\r\n", error);
+			LOG_ERROR(LOG_MODULE_LSM6DSO, "ERROR: Failed to start blocking wait (%ld).\r\n", error);
 		}
 		retryRemain--;
 	}
@@ -228,43 +346,47 @@ static void displaySensors_LSM()
 	if (initialised) {
 		float_t x, y, z;
 		if (!hasXL) {
-			UART_Print(uart_m4_debug, "INFO: No accelerometer data.\r\n");
+			LOG_INFO(LOG_MODULE_LSM6DSO, "INFO: No accelerometer data.\r\n");
 		}
 		else if (!LSM6DSO_ReadXLHuman(driver, &x, &y, &z)) {
-			UART_Print(uart_m4_debug, "ERROR: Failed to read accelerometer data register.\r\n");
+			LOG_ERROR(LOG_MODULE_LSM6DSO, "ERROR: Failed to read accelerometer data register.\r\n");
 		}
 		else {
-			UART_Printf(uart_m4_debug, "Acceleration: [%.3f, %.3f, %.3f] * 10^-3 [g]\r\n",
-				x, y, z);
+			LOG_DEBUG(LOG_MODULE_LSM6DSO, "Acceleration: [%.3f, %.3f, %.3f] * 10^-3 [g]\r\n",
+				LOG_F32(x), LOG_F32(y), LOG_F32(z));
 		}
 
 		if (!hasG) {
-			UART_Print(uart_m4_debug, "INFO: No gyroscope data.\r\n");
+			LOG_INFO(LOG_MODULE_LSM6DSO, "INFO: No gyroscope data.\r\n");
 		}
 		else if (!LSM6DSO_ReadGHuman(driver, &x, &y, &z)) {
-			UART_Print(uart_m4_debug, "ERROR: Failed to read gyroscope data register.\r\n");
+			LOG_ERROR(LOG_MODULE_LSM6DSO, "ERROR: Failed to read gyroscope data register.\r\n");
 		}
 		else {
-			UART_Printf(uart_m4_debug, "Gyroscope:    [%.3f, %.3f, %.3f] * 10^-3 [dps]\r\n",
-				x, y, z);
+			LOG_DEBUG(LOG_MODULE_LSM6DSO, "Gyroscope:    [%.3f, %.3f, %.3f] * 10^-3 [dps]\r\n",
+				LOG_F32(x), LOG_F32(y), LOG_F32(z));
 		}
 
 		float_t t;
 		if (!hasTemp) {
-			UART_Print(uart_m4_debug, "INFO: No temperature data.\r\n");
+			LOG_INFO(LOG_MODULE_LSM6DSO, "INFO: No temperature data.\r\n");
 		}
 		else if (!LSM6DSO_ReadTempCelsius(driver, &t)) {
-			UART_Print(uart_m4_debug, "ERROR: Failed to read temperature data register.\r\n");
+			LOG_ERROR(LOG_MODULE_LSM6DSO, "ERROR: Failed to read temperature data register.\r\n");
 		}
 		else {
-			UART_Printf(uart_m4_debug, "Temperature:   %.3f [*C]\r\n", t);
+			LOG_DEBUG(LOG_MODULE_LSM6DSO, "Temperature:   %.3f [*C]\r\n", LOG_F32(t));
 		}
-		UART_Print(uart_m4_debug, "\r\n");
+		LOG_DEBUG(LOG_MODULE_LSM6DSO, "\r\n");
 	}
 }
 
-static void displaySensors_LPS()
+static XIP_CODE void displaySensors_LPS()
 {
+	if (!Logger_Enabled(LOG_MODULE_LPS22HH, LOG_LEVEL_DEBUG)) {
+		return;
+	}
+
 	bool hasTemp = false, hasPressure = false, orTemp = false, orPressure = false;
 
 	// Wait for sensor board to be ready
@@ -273,7 +395,7 @@ static void displaySensors_LPS()
 	uint32_t retryRemain = STARTUP_RETRY_COUNT;
 	while (retryRemain > 0) {
 		if (!LPS22HH_Status(driver, &orTemp, &orPressure, &hasTemp, &hasPressure)) {
-			UART_Print(uart_m4_debug, "ERROR: Failed to read sensor status register.\r\n");
+			LOG_ERROR(LOG_MODULE_LPS22HH, "ERROR: Failed to read sensor status register.\r\n");
 		}
 		if (hasTemp && hasPressure) {
 			initialised = true;
@@ -281,7 +403,7 @@ static void displaySensors_LPS()
 		}
 		if ((error = GPT_WaitTimer_Blocking(
 			startUpTimer, 500, GPT_UNITS_MILLISEC)) != ERROR_NONE) {
-			UART_Printf(uart_m4_debug, "ERROR: Failed to start blocking wait (%ld).\r\n", error);
+			LOG_ERROR(LOG_MODULE_LPS22HH, "ERROR: Failed to start blocking wait (%ld).\r\n", error);
 		}
 		retryRemain--;
 	}
@@ -290,33 +412,135 @@ static void displaySensors_LPS()
 		float_t temp, pressure;
 
 		if (!hasTemp) {
-			UART_Print(uart_m4_debug, "INFO: No temperature data.\r\n");
+			LOG_INFO(LOG_MODULE_LPS22HH, "INFO: No temperature data.\r\n");
 		}
 		else if (!LPS22HH_ReadTempCelsius(driver, &temp)) {
-			UART_Print(uart_m4_debug, "ERROR: Failed to read temperature sensor data register.\r\n");
+			LOG_ERROR(LOG_MODULE_LPS22HH, "ERROR: Failed to read temperature sensor data register.\r\n");
 		}
 		else {
-			UART_Printf(uart_m4_debug, "Temperature:   %.3f [*C]\r\n", temp);
+			LOG_DEBUG(LOG_MODULE_LPS22HH, "Temperature:   %.3f [*C]\r\n", LOG_F32(temp));
 		}
 
 		if (!hasPressure) {
-			UART_Print(uart_m4_debug, "INFO: No barometric data.\r\n");
+			LOG_INFO(LOG_MODULE_LPS22HH, "INFO: No barometric data.\r\n");
 		}
 		else if (!LPS22HH_ReadPressureHuman(driver, &pressure)) {
-			UART_Print(uart_m4_debug, "ERROR: Failed to read pressure sensor data register.\r\n");
+			LOG_ERROR(LOG_MODULE_LPS22HH, "ERROR: Failed to read pressure sensor data register.\r\n");
 		}
 		else {
-			UART_Printf(uart_m4_debug, "Pressure:      %.3f [hPa]\r\n", pressure);
+			LOG_DEBUG(LOG_MODULE_LPS22HH, "Pressure:      %.3f [hPa]\r\n", LOG_F32(pressure));
 		}
 
-		UART_Print(uart_m4_debug, "\r\n");
+		LOG_DEBUG(LOG_MODULE_LPS22HH, "\r\n");
+	}
+}
+
+static XIP_CODE void displaySensors_AmbientLight() {
+	if (!Logger_Enabled(LOG_MODULE_LIGHT, LOG_LEVEL_DEBUG)) {
+		return;
+	}
+
+	uint32_t lux = Light_ToLux(ADC_SAMPLE_VALUE(adcData[ADC_CHANNEL_LIGHT]));
+	LOG_DEBUG(LOG_MODULE_LIGHT, "Ambient light: %u [lx], PPFD %u [umol/m2/s], %u ADC overruns\r\n",
+		lux, Light_LuxToPpfd(lux), (adc ? ADC_GetOverruns(adc) : 0));
+}
+
+// Logs a sample of every channel, every sampleInterval seconds.
+static void TaskLog(void);
+// Streams a sample record to the UI UART, while telemetry is on.
+static void TaskTelemetry(void);
+// Streams the daily light integral, while telemetry is on.
+static void TaskDli(void);
+// Redraws the changed live values of the UI screen.
+static void TaskUi(void);
+
+// Periodic work of the main loop, see resources/scheduler.h. The debug output runs last and
+// is phased apart, so the sensors aren't all read on the same tick. None is boosted, they
+// mostly wait on the I2C sensors; the screens are rendered from the main loop.
+static Scheduler_Task taskTelemetry = { .name = "telemetry", .run = TaskTelemetry,
+	.period = 1000, .phase = 1000, .deadline = 50, .priority = 0 };
+static Scheduler_Task taskLog = { .name = "log", .run = TaskLog,
+	.period = 2000, .phase = 2000, .deadline = 100, .priority = 1 };
+static Scheduler_Task taskUi = { .name = "ui", .run = TaskUi,
+	.period = 500, .phase = 500, .deadline = 100, .priority = 2 };
+static Scheduler_Task taskDli = { .name = "dli", .run = TaskDli,
+	.period = 60000, .phase = 60000, .deadline = 1000, .priority = 3 };
+static Scheduler_Task taskDebugLsm = { .name = "lsm", .run = displaySensors_LSM,
+	.period = 1000, .phase = 1100, .deadline = 500, .priority = 4 };
+static Scheduler_Task taskDebugLps = { .name = "lps", .run = displaySensors_LPS,
+	.period = 1000, .phase = 1200, .deadline = 500, .priority = 4 };
+static Scheduler_Task taskDebugLight = { .name = "light", .run = displaySensors_AmbientLight,
+	.period = 1000, .phase = 1300, .deadline = 500, .priority = 4 };
+
+static void TaskLog(void)
+{
+	// A new interval applies from the next sample.
+	taskLog.period = (uint32_t)sampleInterval * 1000;
+
+	int16_t tempCurrent = 0;
+	int32_t pressCurrent = 0;
+	LPS22HH_ReadTemp(driver, &tempCurrent);
+	LPS22HH_ReadPressure(driver, &pressCurrent);
+
+	SampleLog_Sample sample = { .timestamp = uptimeMs };
+	sample.value[CHANNEL_TEMPERATURE] = tempCurrent;
+	sample.value[CHANNEL_PRESSURE]    = pressCurrent;
+	sample.value[CHANNEL_LIGHT]       = (uint16_t)ADC_SAMPLE_VALUE(adcData[ADC_CHANNEL_LIGHT]);
+
+	SampleTable_Append(&sampleTable, sample.timestamp, sample.value);
+	SampleLog_Append(&sampleHistory, &sample);
+	FlashLog_Append(&sample);
+
+	Channel_Id channel;
+	for (channel = 0; channel < CHANNEL_COUNT; channel++) {
+		Rollup_Add(&sampleTrend[channel], sample.timestamp / 1000, sample.value[channel]);
+		Stats_Add(&sampleStats[channel], sample.timestamp, sample.value[channel]);
+	}
+}
+
+static void TaskTelemetry(void)
+{
+	if (!telemetryStream) {
+		return;
+	}
+
+	int16_t temp = 0;
+	int32_t press = 0;
+	LPS22HH_ReadTemp(driver, &temp);
+	LPS22HH_ReadPressure(driver, &press);
+
+	Telemetry_Sample sample = {
+		.type        = TELEMETRY_RECORD_SAMPLE,
+		.timestamp   = uptimeMs,
+		.temperature = temp,
+		.pressure    = (uint32_t)press,
+		.light       = (uint16_t)ADC_SAMPLE_VALUE(adcData[ADC_CHANNEL_LIGHT]),
+	};
+	Telemetry_Send(uart_ui, &sample, sizeof(sample));
+}
+
+static void TaskDli(void)
+{
+	static uint32_t reported = 0;
+
+	// The open day, then the days closed since the last run.
+	if (telemetryStream) {
+		Dli_Day day;
+		Dli_Today(&lightDli, &day);
+		SendDliRecord(Dli_DaysClosed(&lightDli), false, &day);
+		while ((reported < Dli_DaysClosed(&lightDli))
+			&& Dli_Get(&lightDli, Dli_DaysClosed(&lightDli) - 1 - reported, &day)) {
+			SendDliRecord(reported++, true, &day);
+		}
 	}
+	reported = Dli_DaysClosed(&lightDli);
 }
 
-static void displaySensors_AmbientLight() {
-	float_t V = ((float_t)(lightData[0].value) * 2.5f) / ADC_MAX_VAL;
-	UART_Printf(uart_m4_debug, "Ambient light: %.3f [V]\r\n", V);
-	adcStatus = 0;
+static void TaskUi(void)
+{
+	if (menu.Update && !menu.refreshMenu && !telemetryStream) {
+		menu.Update(uart_ui);
+	}
 }
 
 _Noreturn void RTCoreMain(void)
@@ -335,146 +559,146 @@ _Noreturn void RTCoreMain(void)
 	//************************************BEGIN SYSTEM INIT*************************************
 
 	VectorTableInit();
-	CPUFreq_Set(26000000);
 
 	// Open debugging UART and report status
-	uart_m4_debug = UART_Open(MT3620_UNIT_UART_DEBUG, 115200, UART_PARITY_NONE, 1, NULL);
+	uart_m4_debug = UART_OpenBuffered(MT3620_UNIT_UART_DEBUG, 115200, UART_PARITY_NONE, 1, NULL,
+		uartDebugRx, sizeof(uartDebugRx), uartDebugTx, sizeof(uartDebugTx));
 	if (uart_m4_debug != NULL) {
 		UI_DebugWelcome(uart_m4_debug);
 	}
+	Logger_Init(uart_m4_debug);
 
 	// Open UI UART and display menu
-	uart_ui = UART_Open(MT3620_UNIT_ISU0, 115200, UART_PARITY_NONE, 1, HandleUartIsu0RxIrq);
+	uart_ui = UART_OpenBuffered(MT3620_UNIT_ISU0, 115200, UART_PARITY_NONE, 1, HandleUartIsu0RxIrq,
+		uartUiRx, sizeof(uartUiRx), uartUiTx, sizeof(uartUiTx));
 	if (uart_ui != NULL) {
 		UI_DisplayMenu(uart_ui);
 	}
 
 	// Open and init startup timer
 	if (!(startUpTimer = GPT_Open(MT3620_UNIT_GPT0, 1000, GPT_MODE_ONE_SHOT))) {
-		UART_Print(uart_m4_debug, "ERROR: Opening startup timer\r\n");
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: Opening startup timer\r\n");
 	}
 
 	// Open and setup I2C comm
 	driver = I2CMaster_Open(MT3620_UNIT_ISU2);
 	if (!driver) {
-		UART_Print(uart_m4_debug,
-			"ERROR: I2C initialisation failed\r\n");
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: I2C initialisation failed\r\n");
 	}
 	I2CMaster_SetBusSpeed(driver, I2C_BUS_SPEED_STANDARD);
 
 	// Verify connection for IMU, temp and pressure sensors and setup devices
 	if (!LSM6DSO_CheckWhoAmI(driver)) {
-		UART_Print(uart_m4_debug,
-			"ERROR: CheckWhoAmI Failed for LSM6DSO.\r\n");
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: CheckWhoAmI Failed for LSM6DSO.\r\n");
 	}
 
 	if (!LSM6DSO_Reset(driver)) {
-		UART_Print(uart_m4_debug,
-			"ERROR: Reset Failed for LSM6DSO.\r\n");
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: Reset Failed for LSM6DSO.\r\n");
 	}
 	if (!LPS22HH_OpenViaHost(driver)) {
-		UART_Print(uart_m4_debug,
-			"ERROR: SHub Init Failed for LPS22HH.\r\n");
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: SHub Init Failed for LPS22HH.\r\n");
 	}
 
 	if (!LSM6DSO_ConfigXL(driver, 1, 4, false)) {
-		UART_Print(uart_m4_debug,
-			"ERROR: Failed to configure LSM6DSO accelerometer.\r\n");
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: Failed to configure LSM6DSO accelerometer.\r\n");
 	}
 
 	if (!LSM6DSO_ConfigG(driver, 1, 500)) {
-		UART_Print(uart_m4_debug,
-			"ERROR: Failed to configure LSM6DSO accelerometer.\r\n");
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: Failed to configure LSM6DSO accelerometer.\r\n");
 	}
 
 	displaySensors_LSM();
 
 	if (!LPS22HH_CheckWhoAmI(driver)) {
-		UART_Print(uart_m4_debug,
-			"ERROR: CheckWhoAmI Failed for LPS22HH.\r\n");
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: CheckWhoAmI Failed for LPS22HH.\r\n");
 	}
 
 	if (!LPS22HH_Reset(driver)) {
-		UART_Print(uart_m4_debug,
-			"ERROR: Reset Failed for LPS22HH.\r\n");
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: Reset Failed for LPS22HH.\r\n");
 	}
 
 	if (!LPS22HH_Config(driver, 0x04, false, false, false, false)) {
-		UART_Print(uart_m4_debug,
-			"ERROR: Failed to configure LPS22HH.\r\n");
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: Failed to configure LPS22HH.\r\n");
 	}
 
 	displaySensors_LPS();
 
 
-	//Initialise ADC driver, and then configure it to use channel 0
-	AdcContext* handle = ADC_Open(MT3620_UNIT_ADC0);
+	//Initialise ADC driver, and then configure it to scan channels 0 to 3
+	Dli_Init(&lightDli, ADC_SCAN_RATE);
+	adc = ADC_Open(MT3620_UNIT_ADC0);
 
-	if (ADC_ReadPeriodicAsync(handle, &callbackADC, ADC_DATA_SIZE, lightData, rawData,
-		0x1, 1000, 2500) != ERROR_NONE) {
-		UART_Print(uart_m4_debug, "Error: Failed to initialise ADC.\r\n");
+	if ((ADC_Configure(adc, &adcConfig) != ERROR_NONE)
+		|| (ADC_SetDecimation(adc, ADC_DECIMATION) != ERROR_NONE)
+		|| (ADC_SetBlockCount(adc, ADC_BLOCKS) != ERROR_NONE)
+		|| (ADC_ReadPeriodicPackedAsync(adc, &callbackADC, ADC_FIFO_SIZE, &adcBlocks[0][0], rawData,
+			ADC_CHANNEL_MASK, 0, ADC_VREF) != ERROR_NONE)) {
+		LOG_ERROR(LOG_MODULE_SYSTEM, "Error: Failed to initialise ADC.\r\n");
 	}
 
 
-	// Init sampling timer
-	if (!(samplingTimer = GPT_Open(MT3620_UNIT_GPT1, 1000, GPT_MODE_REPEAT))) {
-		UART_Print(uart_m4_debug, "ERROR: Opening sampling timer\r\n");
+	// Init scheduler timers: GPT2 free-running as the clock, GPT1 one-shot to wake from idle,
+	// both at 32 kHz
+	if (!(clockTimer = GPT_Open(MT3620_UNIT_GPT2, 32768, GPT_MODE_NONE))
+		|| (GPT_Start_Freerun(clockTimer) != ERROR_NONE)) {
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: Opening scheduler clock\r\n");
+	}
+	if (!(wakeupTimer = GPT_Open(MT3620_UNIT_GPT1, 32768, GPT_MODE_ONE_SHOT))) {
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: Opening scheduler wakeup timer\r\n");
+	}
+	if (Scheduler_Init(clockTimer, wakeupTimer) != ERROR_NONE) {
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: Failed to initialise scheduler\r\n");
+	}
+	if (Governor_Init(clockTimer) != ERROR_NONE) {
+		LOG_ERROR(LOG_MODULE_SYSTEM, "ERROR: Failed to initialise clock governor\r\n");
 	}
 
 	displaySensors_AmbientLight();
 
-	GPT_StartTimeout(samplingTimer, 1000, GPT_UNITS_MILLISEC, &callbackSamplingTimer);
-
-	uint8_t sampleCounter = 0;
+	SampleTable_Init(&sampleTable);
+	SampleLog_Init(&sampleHistory);
+	Channel_Id channel;
+	for (channel = 0; channel < CHANNEL_COUNT; channel++) {
+		Rollup_Init(&sampleTrend[channel]);
+		Stats_Init(&sampleStats[channel]);
+	}
 
-	ringBuffer_int16_Init(&temperatureLog, logSize);
-	ringBuffer_uint32_Init(&pressureLog, logSize);
-	ringBuffer_uint32_Init(&lightLog, logSize);
+	// Mount the sample log on the external flash, sampling goes on without it
+	int32_t flashStatus = FlashLog_Init(MT3620_UNIT_ISU1);
+	if (flashStatus != ERROR_NONE) {
+		LOG_WARN(LOG_MODULE_SYSTEM, "WARNING: No flash sample log (%ld).\r\n", flashStatus);
+	}
+	// The SPI and UART interrupts move the flash log and exports on without queueing a callback,
+	// and the flash status is polled on a timed wakeup
+	Scheduler_SetIdleLimit(WorkIdleLimit);
+
+	Scheduler_Add(&taskTelemetry);
+	Scheduler_Add(&taskLog);
+	Scheduler_Add(&taskUi);
+	Scheduler_Add(&taskDli);
+	Scheduler_Add(&taskDebugLsm);
+	Scheduler_Add(&taskDebugLps);
+	Scheduler_Add(&taskDebugLight);
 
 	//*************************************END SYSTEM INIT**************************************
 	//******************************************************************************************
 
 	for (;;) {
-		if (logResize == true) {
-			ringBuffer_int16_Resize(&temperatureLog, logSize);
-			ringBuffer_int16_Resize(&pressureLog, logSize);
-			ringBuffer_uint32_Resize(&lightLog, logSize);
-			logResize = false;
-		}
+		Scheduler_Run();
 
-		if (menu.refreshMenu == true) {
+		if (menu.refreshMenu == true && !telemetryStream) {
+			// Rendering a full screen is compute bound, see resources/governor.h
+			Governor_Boost();
 			updateMenuCallback(&menu);
 
 			menu.Callback(uart_ui);
 			menu.refreshMenu = false;
+			Governor_Release();
 		}
 
-		if (samplingTimeFlag) {
-
-			if (sampleCounter >= sampleInterval) {
-				int16_t tempCurrent = 0;
-				uint32_t pressCurrent = 0;
-				
-				LPS22HH_ReadTemp(driver, &tempCurrent);
-				ringBuffer_int16_Write(&temperatureLog, tempCurrent);
-				
-				LPS22HH_ReadPressure(driver, &pressCurrent);
-				ringBuffer_uint32_Write(&pressureLog, pressCurrent);
-
-				ringBuffer_uint32_Write(&temperatureLog, lightData[0].value);
-
-				sampleCounter = 0;
-			}
-
-			// PRINT TO DEBUG UART
-			displaySensors_LSM();
-			displaySensors_LPS();
-			displaySensors_AmbientLight();
-
-			samplingTimeFlag = false;
-			++sampleCounter;
-		}
-		__asm__("wfi");
-		InvokeCallbacks();
+		Logger_Flush();
+		Cmd_Poll();
+		FlashLog_Poll();
+		Scheduler_Idle();
 	}
 }
\ No newline at end of file
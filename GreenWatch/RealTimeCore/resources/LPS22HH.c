@@ -2,8 +2,7 @@
 #include "LSM6DSO.h"
 #include "../lib/UART.h"
 #include "../lib/Print.h"
-
-extern UART* uart_m4_debug;
+#include "logger.h"
 
 bool LPS22HH_RegWrite(I2CMaster* driver, uint8_t addr, uint8_t value) {
 	const uint8_t cmd[] = { addr, value };
@@ -296,8 +295,7 @@ bool LPS22HH_ReadPressureHuman(I2CMaster* driver, float_t* pressure)
 bool LPS22HH_OpenViaHost(I2CMaster* driver) {
 	// Initialize host (LSM6DSO)
 	if (!LSM6DSO_CheckWhoAmI(driver)) {
-		UART_Print(uart_m4_debug,
-			"ERROR: CheckWhoAmI Failed for LSM6DSO.\r\n");
+		LOG_ERROR(LOG_MODULE_LPS22HH, "ERROR: CheckWhoAmI Failed for LSM6DSO.\r\n");
 		return false;
 	}
 
@@ -0,0 +1,158 @@
+#include <strings.h>
+#include "channels.h"
+#include "light.h"
+
+#define SAMPLE_TABLE_MASK (SAMPLE_LOG_CAPACITY - 1)
+
+// Means of codes are rounded to the nearest code for the lookup table.
+static float_t Channel_LightToLux(float_t raw)
+{
+	return (float_t)Light_ToLux((raw <= 0.0f) ? 0 : (uint16_t)(raw + 0.5f));
+}
+
+// A type is signed if -1 converts to less than 1. Comparing with 1 rather than 0 keeps
+// -Wtype-limits quiet for the unsigned ones.
+const Channel_Descriptor channelTable[CHANNEL_COUNT] = {
+#define CHANNEL_DESCRIPTOR(id, column, type, name_, label_, unit_, scale_, convert_) \
+	[CHANNEL_##id] = { \
+		.name     = name_, \
+		.label    = label_, \
+		.unit     = unit_, \
+		.scale    = scale_, \
+		.convert  = convert_, \
+		.size     = sizeof(type), \
+		.isSigned = (((type)-1) < (type)1), \
+		.offset   = offsetof(SampleTable, column), \
+	},
+	CHANNEL_LIST(CHANNEL_DESCRIPTOR)
+#undef CHANNEL_DESCRIPTOR
+};
+
+Channel_Id Channel_Find(const char* name)
+{
+	Channel_Id channel;
+	for (channel = 0; channel < CHANNEL_COUNT; channel++) {
+		if (name && (strcasecmp(name, channelTable[channel].name) == 0)) {
+			break;
+		}
+	}
+	return channel;
+}
+
+void SampleTable_Init(SampleTable* table)
+{
+	SampleTable_Time_Init(&table->time);
+}
+
+int32_t Channel_RawAt(Channel_Id channel, const void* column, uint32_t slot)
+{
+	const Channel_Descriptor* desc = &channelTable[channel];
+	switch (desc->size) {
+	case 1:
+		return desc->isSigned ? ((const int8_t*)column)[slot] : ((const uint8_t*)column)[slot];
+	case 2:
+		return desc->isSigned ? ((const int16_t*)column)[slot] : ((const uint16_t*)column)[slot];
+	default:
+		return ((const int32_t*)column)[slot];
+	}
+}
+
+static int32_t SampleTable_Read(const SampleTable* table, Channel_Id channel, uint32_t slot)
+{
+	return Channel_RawAt(channel, (const uint8_t*)table + channelTable[channel].offset, slot);
+}
+
+static void SampleTable_Write(SampleTable* table, Channel_Id channel, uint32_t slot, int32_t value)
+{
+	void* column = (uint8_t*)table + channelTable[channel].offset;
+	switch (channelTable[channel].size) {
+	case 1:
+		((uint8_t*)column)[slot] = (uint8_t)value;
+		break;
+	case 2:
+		((uint16_t*)column)[slot] = (uint16_t)value;
+		break;
+	default:
+		((uint32_t*)column)[slot] = (uint32_t)value;
+		break;
+	}
+}
+
+void SampleTable_Append(SampleTable* table, uint32_t time, const int32_t value[CHANNEL_COUNT])
+{
+	// The channel columns fill the slot the timestamp goes to, Write then publishes the row.
+	uint32_t slot = table->time.head & SAMPLE_TABLE_MASK;
+	Channel_Id channel;
+	for (channel = 0; channel < CHANNEL_COUNT; channel++) {
+		SampleTable_Write(table, channel, slot, value[channel]);
+	}
+	SampleTable_Time_Write(&table->time, time);
+}
+
+static void SampleTable_ReadValues(const SampleTable* table, uint32_t index, SampleTable_Row* row)
+{
+	uint32_t slot = index & SAMPLE_TABLE_MASK;
+	Channel_Id channel;
+	for (channel = 0; channel < CHANNEL_COUNT; channel++) {
+		row->value[channel] = SampleTable_Read(table, channel, slot);
+	}
+}
+
+bool SampleTable_Get(const SampleTable* table, uint32_t age, SampleTable_Row* row)
+{
+	if (!SampleTable_Time_Peek(&table->time, age, &row->time)) {
+		return false;
+	}
+	SampleTable_ReadValues(table, table->time.head - 1 - age, row);
+	return true;
+}
+
+void SampleTable_CursorInit(SampleTable_Cursor* cursor, const SampleTable* table, uint32_t age)
+{
+	cursor->table = table;
+	SampleTable_Time_CursorInit(&cursor->time, &table->time, age);
+}
+
+bool SampleTable_CursorNext(SampleTable_Cursor* cursor, SampleTable_Row* row)
+{
+	uint32_t index = cursor->time.index;
+	if (!SampleTable_Time_CursorNext(&cursor->time, &row->time)) {
+		return false;
+	}
+	SampleTable_ReadValues(cursor->table, index, row);
+	return true;
+}
+
+uint32_t SampleTable_Snapshot(const SampleTable* table, Channel_Id channel, void* dst, uint32_t* time, uint32_t max)
+{
+	const uint8_t* column = (const uint8_t*)table + channelTable[channel].offset;
+	uint32_t size = channelTable[channel].size;
+
+	// The same two part copy as SampleTable_Time_Snapshot(), for both columns at once.
+	uint32_t head, count;
+	do {
+		head  = table->time.head;
+		count = head - table->time.tail;
+		if (count > max) {
+			count = max;
+		}
+		uint32_t first = (head - count) & SAMPLE_TABLE_MASK;
+		uint32_t part  = SAMPLE_LOG_CAPACITY - first;
+		if (part > count) {
+			part = count;
+		}
+		__builtin_memcpy(dst, &column[first * size], part * size);
+		__builtin_memcpy((uint8_t*)dst + (part * size), column, (count - part) * size);
+		if (time) {
+			__builtin_memcpy(time, &table->time.data[first], part * sizeof(*time));
+			__builtin_memcpy(&time[part], table->time.data, (count - part) * sizeof(*time));
+		}
+		RINGBUFFER_BARRIER();
+	} while (table->time.head != head);
+	return count;
+}
+
+uint32_t SampleTable_CountAfter(const SampleTable* table, uint32_t time)
+{
+	return SampleTable_Time_CountAbove(&table->time, time);
+}
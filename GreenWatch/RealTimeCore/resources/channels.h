@@ -0,0 +1,150 @@
+#ifndef CHANNELS_H_
+#define CHANNELS_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include "utilities.h"
+
+// Registry of the logged channels and the table of recent samples.
+//
+// CHANNEL_LIST is the only place a channel is declared. It generates the Channel_Id enum, one
+// typed column per channel in SampleTable and the channelTable descriptors, so adding a channel
+// is one line here plus reading it in the main loop.
+//
+// SampleTable is column oriented: a timestamp column and one column per channel. The timestamp
+// column is a ring buffer of utilities.h whose head and tail index the other columns too.
+// Appending a row writes every channel column, then the timestamp, which moves the head once;
+// a scan of one channel reads one contiguous array.
+
+/// <summary>Rows kept in a SampleTable, must be a power of two. The UI shows the latest logSize
+/// of them.</summary>
+#define SAMPLE_LOG_CAPACITY 64
+
+// X(id, column, type, name, label, unit, scale, convert): the raw value is converted to the
+// unit by convert if it's not NULL, by multiplying with scale otherwise.
+#define CHANNEL_LIST(X) \
+	X(TEMPERATURE, temperature, int16_t,  "temp",     "Temperature",   " [*C]",  (1.0f / 100.0f),  NULL) \
+	X(PRESSURE,    pressure,    uint32_t, "pressure", "Pressure",      " [hPa]", (1.0f / 4096.0f), NULL) \
+	X(LIGHT,       light,       uint16_t, "light",    "Ambient light", " [lx]",  0.0f,             Channel_LightToLux)
+
+typedef enum {
+#define CHANNEL_ENUM(id, column, type, name, label, unit, scale, convert) CHANNEL_##id,
+	CHANNEL_LIST(CHANNEL_ENUM)
+#undef CHANNEL_ENUM
+	CHANNEL_COUNT
+} Channel_Id;
+
+typedef struct {
+	/// <summary>Name used by the command interface.</summary>
+	const char* name;
+	const char* label;
+	const char* unit;
+	float_t     scale;
+	/// <summary>Non-linear conversion to the unit, NULL for a linear one.</summary>
+	float_t     (*convert)(float_t raw);
+	/// <summary>Size and signedness of a raw value in the column.</summary>
+	uint8_t     size;
+	bool        isSigned;
+	/// <summary>Offset of the column in SampleTable.</summary>
+	uint16_t    offset;
+} Channel_Descriptor;
+
+extern const Channel_Descriptor channelTable[CHANNEL_COUNT];
+
+RINGBUFFER_DEFINE(SampleTable_Time, uint32_t, SAMPLE_LOG_CAPACITY)
+
+typedef struct {
+	/// <summary>Uptime of every row [ms], ascending.</summary>
+	SampleTable_Time time;
+#define CHANNEL_COLUMN(id, column, type, name, label, unit, scale, convert) type column[SAMPLE_LOG_CAPACITY];
+	CHANNEL_LIST(CHANNEL_COLUMN)
+#undef CHANNEL_COLUMN
+} SampleTable;
+
+/// <summary>One row, with the raw values widened to 32 bits.</summary>
+typedef struct {
+	uint32_t time;
+	int32_t  value[CHANNEL_COUNT];
+} SampleTable_Row;
+
+/// <summary>Read position, see <see cref="SampleTable_CursorInit" />.</summary>
+typedef struct {
+	const SampleTable*      table;
+	SampleTable_Time_Cursor time;
+} SampleTable_Cursor;
+
+/// <summary>Returns the channel with the given name (case insensitive), or CHANNEL_COUNT.</summary>
+Channel_Id Channel_Find(const char* name);
+
+/// <summary>Reads a raw value of a channel from an array in the column's own type, e.g. a
+/// SampleTable_Snapshot(), widened to 32 bits.</summary>
+int32_t Channel_RawAt(Channel_Id channel, const void* column, uint32_t index);
+
+/// <summary>Converts a raw value of a channel, or a mean of raw values, to its unit.</summary>
+static inline float_t Channel_ToUnit(Channel_Id channel, float_t raw)
+{
+	const Channel_Descriptor* desc = &channelTable[channel];
+	return desc->convert ? desc->convert(raw) : (raw * desc->scale);
+}
+
+/// <summary>Converts a spread around a raw value, e.g. a standard deviation, to the unit with
+/// the local slope of the conversion.</summary>
+static inline float_t Channel_SpreadToUnit(Channel_Id channel, float_t center, float_t spread)
+{
+	return (Channel_ToUnit(channel, center + spread) - Channel_ToUnit(channel, center - spread)) / 2.0f;
+}
+
+/// <summary>Empties a table.</summary>
+void SampleTable_Init(SampleTable* table);
+
+/// <summary>Returns the number of rows in a table.</summary>
+static inline uint32_t SampleTable_Count(const SampleTable* table)
+{
+	return SampleTable_Time_Count(&table->time);
+}
+
+/// <summary>
+/// <para>Appends a row, overwriting the oldest one when the table is full.</para>
+/// </summary>
+/// <param name="table">Table to write.</param>
+/// <param name="time">Uptime of the sample [ms], not less than the previous one.</param>
+/// <param name="value">Raw value of every channel, indexed by Channel_Id.</param>
+void SampleTable_Append(SampleTable* table, uint32_t time, const int32_t value[CHANNEL_COUNT]);
+
+/// <summary>
+/// <para>Reads a row without removing it.</para>
+/// </summary>
+/// <param name="age">0 for the latest row.</param>
+/// <returns>false if the row doesn't exist.</returns>
+bool SampleTable_Get(const SampleTable* table, uint32_t age, SampleTable_Row* row);
+
+/// <summary>
+/// <para>Starts a walk from a row towards older ones. The cursor stays on its row when new rows
+/// are appended and ends where the oldest rows were overwritten.</para>
+/// </summary>
+void SampleTable_CursorInit(SampleTable_Cursor* cursor, const SampleTable* table, uint32_t age);
+
+/// <summary>Reads the row under the cursor and moves to the next older one.</summary>
+/// <returns>false at the end of the table.</returns>
+bool SampleTable_CursorNext(SampleTable_Cursor* cursor, SampleTable_Row* row);
+
+/// <summary>
+/// <para>Copies the latest raw values of one channel oldest first, in the column's own type,
+/// with at most two memcpy() calls per column. Retries if the table was written meanwhile, so
+/// the copy is consistent.</para>
+/// </summary>
+/// <param name="table">Table to read.</param>
+/// <param name="channel">Column to copy.</param>
+/// <param name="dst">Receives up to max values of channelTable[channel].size bytes each, read
+/// them with Channel_RawAt().</param>
+/// <param name="time">Receives the uptime of every copied row [ms], may be NULL.</param>
+/// <param name="max">Largest number of values to copy.</param>
+/// <returns>Number of values copied.</returns>
+uint32_t SampleTable_Snapshot(const SampleTable* table, Channel_Id channel, void* dst, uint32_t* time, uint32_t max);
+
+/// <summary>Returns the number of rows newer than time [ms], by binary search.</summary>
+uint32_t SampleTable_CountAfter(const SampleTable* table, uint32_t time);
+
+#endif // #ifndef CHANNELS_H_
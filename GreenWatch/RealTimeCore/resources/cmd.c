@@ -0,0 +1,814 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "cmd.h"
+#include "logger.h"
+#include "ui_msg.h"
+#include "uart_bench.h"
+#include "rollup.h"
+#include "sample_log.h"
+#include "flash_log.h"
+#include "telemetry.h"
+#include "channels.h"
+#include "light.h"
+#include "dli.h"
+#include "scheduler.h"
+#include "governor.h"
+
+#define CMD_SET_MAX 8
+#define CMD_BENCH_BYTES 4096
+
+extern uint8_t sampleInterval;
+extern uint8_t logSize;
+extern bool telemetryStream;
+extern SampleTable sampleTable;
+extern Rollup_Store sampleTrend[CHANNEL_COUNT];
+extern SampleLog_Store sampleHistory;
+extern Stats_Channel sampleStats[CHANNEL_COUNT];
+
+extern I2CMaster* driver;
+extern const ADC_Sample* adcData;
+extern Dli_Store lightDli;
+
+static char cmdLine[CMD_LINE_MAX + 1];
+static uint32_t cmdLength = 0;
+static bool cmdOverflow = false;
+
+// Export in progress: the UART it goes to and the free-running indices of the next block and
+// the end, see SampleLog_Store.
+static UART* exportHandle = NULL;
+static uint32_t exportNext = 0;
+static uint32_t exportEnd = 0;
+static bool exportDelimit = false;
+
+static const char* Cmd_Help(UART* handle, char* args);
+static const char* Cmd_Set(UART* handle, char* args);
+static const char* Cmd_Get(UART* handle, char* args);
+static const char* Cmd_Mode(UART* handle, char* args);
+static const char* Cmd_Bench(UART* handle, char* args);
+static const char* Cmd_Trend(UART* handle, char* args);
+static const char* Cmd_History(UART* handle, char* args);
+static const char* Cmd_Export(UART* handle, char* args);
+static const char* Cmd_Flash(UART* handle, char* args);
+static const char* Cmd_Stats(UART* handle, char* args);
+static const char* Cmd_Cal(UART* handle, char* args);
+static const char* Cmd_Dli(UART* handle, char* args);
+static const char* Cmd_Tasks(UART* handle, char* args);
+static const char* Cmd_Cpu(UART* handle, char* args);
+
+static const Cmd_Entry cmdTable[] = {
+	{ "help", "help", Cmd_Help },
+	{ "set",  "set interval=<s> logsize=<n> level.<module>=<0-4> clock=<hhmm> ...", Cmd_Set },
+	{ "get",  "get temp|pressure|light[.log [[@]<from>..<to>]|.<n>m|.<n>h]", Cmd_Get },
+	{ "trend", "trend temp|pressure|light 1m|15m|1h [<from>..<to>]", Cmd_Trend },
+	{ "history", "history [<from>..<to>]", Cmd_History },
+	{ "export", "export", Cmd_Export },
+	{ "flash", "flash [sync|<from>..<to>]", Cmd_Flash },
+	{ "stats", "stats [reset]", Cmd_Stats },
+	{ "cal", "cal [add <lux>|apply|clear|reset]", Cmd_Cal },
+	{ "dli", "dli", Cmd_Dli },
+	{ "tasks", "tasks [reset]", Cmd_Tasks },
+	{ "cpu", "cpu [auto|low|high]", Cmd_Cpu },
+	{ "mode", "mode bin|text", Cmd_Mode },
+	{ "bench", "bench <baud> [<bytes>]", Cmd_Bench },
+};
+
+#define CMD_TABLE_SIZE (sizeof(cmdTable) / sizeof(cmdTable[0]))
+
+bool Cmd_LineEmpty(void)
+{
+	return (cmdLength == 0) && !cmdOverflow;
+}
+
+char* Cmd_LineAppend(UART* echo, uint8_t c)
+{
+	if ((c == '\r') || (c == '\n')) {
+		// Ignore the second half of CR LF and empty lines.
+		if (Cmd_LineEmpty()) {
+			return NULL;
+		}
+		if (echo) {
+			UART_Print(echo, "\r\n");
+		}
+
+		bool overflow = cmdOverflow;
+		cmdLine[cmdLength] = '\0';
+		cmdLength = 0;
+		cmdOverflow = false;
+		if (overflow) {
+			if (echo) {
+				UART_Print(echo, "ERR line too long\r\n");
+			}
+			return NULL;
+		}
+		return cmdLine;
+	}
+
+	if ((c == '\b') || (c == 0x7F)) {
+		if (cmdLength > 0) {
+			cmdLength--;
+			if (echo) {
+				UART_Print(echo, "\b \b");
+			}
+		}
+		return NULL;
+	}
+
+	if ((c < ' ') || (c > '~')) {
+		return NULL;
+	}
+
+	// Keep discarding until the end of an overlong line rather than running its tail.
+	if (cmdLength >= CMD_LINE_MAX) {
+		cmdOverflow = true;
+		return NULL;
+	}
+
+	cmdLine[cmdLength++] = (char)c;
+	if (echo) {
+		UART_Write(echo, &c, 1);
+	}
+	return NULL;
+}
+
+static char* Cmd_NextToken(char** cursor)
+{
+	char* token = *cursor;
+	while (*token == ' ') {
+		token++;
+	}
+	if (*token == '\0') {
+		*cursor = token;
+		return NULL;
+	}
+
+	char* end = token;
+	while ((*end != ' ') && (*end != '\0')) {
+		end++;
+	}
+	if (*end != '\0') {
+		*end++ = '\0';
+	}
+	*cursor = end;
+	return token;
+}
+
+static bool Cmd_ParseUInt(const char* text, uint32_t* value)
+{
+	char* end;
+	if ((text == NULL) || (*text < '0') || (*text > '9')) {
+		return false;
+	}
+	*value = strtoul(text, &end, 10);
+	return (*end == '\0');
+}
+
+// Parses "<from>..<to>", a single "<index>" or nothing for the whole range.
+static bool Cmd_ParseRange(char* text, uint32_t* from, uint32_t* to)
+{
+	if (text == NULL) {
+		return true;
+	}
+
+	char* dots = strstr(text, "..");
+	if (dots == NULL) {
+		if (!Cmd_ParseUInt(text, from)) {
+			return false;
+		}
+		*to = *from;
+		return true;
+	}
+
+	*dots = '\0';
+	return Cmd_ParseUInt(text, from) && Cmd_ParseUInt(dots + 2, to) && (*from <= *to);
+}
+
+static const char* Cmd_Help(UART* handle, char* args)
+{
+	uint32_t i;
+	for (i = 0; i < CMD_TABLE_SIZE; i++) {
+		UART_Printf(handle, "%s\r\n", cmdTable[i].usage);
+	}
+	UART_Print(handle, "Modules:");
+	for (i = 0; i < LOG_MODULE_COUNT; i++) {
+		UART_Printf(handle, " %s", Logger_ModuleName(i));
+	}
+	UART_Print(handle, "\r\n");
+	return NULL;
+}
+
+typedef enum {
+	CMD_SET_INTERVAL,
+	CMD_SET_LOGSIZE,
+	CMD_SET_LEVEL,
+	CMD_SET_CLOCK,
+} Cmd_SetKey;
+
+typedef struct {
+	Cmd_SetKey key;
+	uint8_t    module;
+	uint32_t   value;
+} Cmd_SetItem;
+
+static const char* Cmd_Set(UART* handle, char* args)
+{
+	Cmd_SetItem items[CMD_SET_MAX];
+	uint32_t count = 0;
+
+	// Validate every assignment first, so a bad one leaves all settings untouched.
+	char* token;
+	while ((token = Cmd_NextToken(&args)) != NULL) {
+		if (count >= CMD_SET_MAX) {
+			return "too many settings";
+		}
+
+		char* equals = strchr(token, '=');
+		if (equals == NULL) {
+			return "expected key=value";
+		}
+		*equals = '\0';
+
+		Cmd_SetItem* item = &items[count++];
+		if (!Cmd_ParseUInt(equals + 1, &item->value)) {
+			return "bad value";
+		}
+
+		if (strcasecmp(token, "interval") == 0) {
+			item->key = CMD_SET_INTERVAL;
+			if ((item->value == 0) || (item->value > UINT8_MAX)) {
+				return "interval out of range";
+			}
+		}
+		else if (strcasecmp(token, "logsize") == 0) {
+			item->key = CMD_SET_LOGSIZE;
+			if ((item->value == 0) || (item->value > SAMPLE_LOG_CAPACITY)) {
+				return "logsize out of range";
+			}
+		}
+		else if (strncasecmp(token, "level.", 6) == 0) {
+			item->key = CMD_SET_LEVEL;
+			for (item->module = 0; item->module < LOG_MODULE_COUNT; item->module++) {
+				if (strcasecmp(token + 6, Logger_ModuleName(item->module)) == 0) {
+					break;
+				}
+			}
+			if (item->module >= LOG_MODULE_COUNT) {
+				return "unknown module";
+			}
+			if (item->value > LOG_LEVEL_NONE) {
+				return "level out of range";
+			}
+		}
+		else if (strcasecmp(token, "clock") == 0) {
+			item->key = CMD_SET_CLOCK;
+			if (((item->value / 100) > 23) || ((item->value % 100) > 59)) {
+				return "clock out of range";
+			}
+		}
+		else {
+			return "unknown setting";
+		}
+	}
+
+	if (count == 0) {
+		return "nothing to set";
+	}
+
+	uint32_t i;
+	for (i = 0; i < count; i++) {
+		switch (items[i].key) {
+		case CMD_SET_INTERVAL:
+			sampleInterval = (uint8_t)items[i].value;
+			break;
+		case CMD_SET_LOGSIZE:
+			logSize = (uint8_t)items[i].value;
+			break;
+		case CMD_SET_LEVEL:
+			Logger_SetLevel(items[i].module, (uint8_t)items[i].value);
+			break;
+		case CMD_SET_CLOCK:
+			Dli_SetClock(&lightDli, ((items[i].value / 100) * 3600) + ((items[i].value % 100) * 60));
+			break;
+		}
+	}
+	return NULL;
+}
+
+// Parses "<n>m" or "<n>h" to seconds.
+static bool Cmd_ParseDuration(const char* text, uint32_t* seconds)
+{
+	char* end;
+	if ((text == NULL) || (*text < '0') || (*text > '9')) {
+		return false;
+	}
+	uint32_t value = strtoul(text, &end, 10);
+	if (strcasecmp(end, "m") == 0) {
+		*seconds = value * 60;
+	}
+	else if (strcasecmp(end, "h") == 0) {
+		*seconds = value * 3600;
+	}
+	else {
+		return false;
+	}
+	return (value > 0);
+}
+
+static void Cmd_PrintBucket(UART* handle, Channel_Id which, const Rollup_Bucket* bucket)
+{
+	if (bucket->count == 0) {
+		UART_Print(handle, "- - - 0\r\n");
+		return;
+	}
+	UART_Printf(handle, "%.3f %.3f %.3f %u\r\n",
+		Channel_ToUnit(which, bucket->min), Channel_ToUnit(which, bucket->max),
+		Channel_ToUnit(which, bucket->mean), bucket->count);
+}
+
+static const char* Cmd_Get(UART* handle, char* args)
+{
+	char* channel = Cmd_NextToken(&args);
+	if (channel == NULL) {
+		return "expected channel";
+	}
+
+	char* suffix = strchr(channel, '.');
+	if (suffix != NULL) {
+		*suffix++ = '\0';
+	}
+
+	Channel_Id which = Channel_Find(channel);
+	if (which == CHANNEL_COUNT) {
+		return "unknown channel";
+	}
+
+	// Summary of a time window from the rollup tiers: min max mean count.
+	uint32_t window;
+	if ((suffix != NULL) && Cmd_ParseDuration(suffix, &window)) {
+		Rollup_Bucket summary;
+		if (!Rollup_Summary(&sampleTrend[which], window, &summary)) {
+			return "no data for window";
+		}
+		Cmd_PrintBucket(handle, which, &summary);
+		return NULL;
+	}
+
+	if ((suffix != NULL) && (strcasecmp(suffix, "log") != 0)) {
+		return "unknown channel";
+	}
+
+	if (suffix == NULL) {
+		float_t value = 0;
+		switch (which) {
+		case CHANNEL_TEMPERATURE:
+			if (!LPS22HH_ReadTempCelsius(driver, &value)) {
+				return "sensor read failed";
+			}
+			break;
+		case CHANNEL_PRESSURE:
+			if (!LPS22HH_ReadPressureHuman(driver, &value)) {
+				return "sensor read failed";
+			}
+			break;
+		case CHANNEL_LIGHT:
+		default:
+			value = Channel_ToUnit(CHANNEL_LIGHT, ADC_SAMPLE_VALUE(adcData[ADC_CHANNEL_LIGHT]));
+			break;
+		}
+		UART_Printf(handle, "%.3f\r\n", value);
+		return NULL;
+	}
+
+	// Log entries are addressed by age, 0 being the latest sample, or with '@' by uptime [s].
+	char* range = Cmd_NextToken(&args);
+	bool byTime = (range != NULL) && (*range == '@');
+	uint32_t from = 0, to = UINT32_MAX;
+	if (!Cmd_ParseRange(byTime ? &range[1] : range, &from, &to)) {
+		return "bad range";
+	}
+	if (byTime) {
+		// Times are logged in ascending order, so the range is a run of ages.
+		uint32_t newer = SampleTable_CountAfter(&sampleTable, (to >= (UINT32_MAX / 1000)) ? UINT32_MAX : ((to * 1000) + 999));
+		uint32_t older = (from == 0) ? SampleTable_Count(&sampleTable) : SampleTable_CountAfter(&sampleTable, (from * 1000) - 1);
+		if (older <= newer) {
+			return NULL;
+		}
+		from = newer;
+		to   = older - 1;
+	}
+
+	SampleTable_Cursor cursor;
+	SampleTable_Row row;
+	SampleTable_CursorInit(&cursor, &sampleTable, from);
+
+	uint32_t age;
+	for (age = from; (age <= to) && SampleTable_CursorNext(&cursor, &row); age++) {
+		UART_Printf(handle, "%u %.3f\r\n", byTime ? (row.time / 1000) : age, Channel_ToUnit(which, row.value[which]));
+	}
+	return NULL;
+}
+
+static const char* Cmd_Trend(UART* handle, char* args)
+{
+	Channel_Id which = Channel_Find(Cmd_NextToken(&args));
+	if (which == CHANNEL_COUNT) {
+		return "unknown channel";
+	}
+
+	uint32_t period, tier;
+	if (!Cmd_ParseDuration(Cmd_NextToken(&args), &period)) {
+		return "expected 1m, 15m or 1h";
+	}
+	for (tier = 0; tier < ROLLUP_TIER_COUNT; tier++) {
+		if (Rollup_TierPeriod(tier) == period) {
+			break;
+		}
+	}
+	if (tier >= ROLLUP_TIER_COUNT) {
+		return "expected 1m, 15m or 1h";
+	}
+
+	uint32_t from = 0, to = UINT32_MAX;
+	if (!Cmd_ParseRange(Cmd_NextToken(&args), &from, &to)) {
+		return "bad range";
+	}
+
+	// One line per bucket, newest first: age start[s] min max mean count.
+	Rollup_Bucket bucket;
+	uint32_t age, start;
+	for (age = from; (age <= to) && Rollup_Get(&sampleTrend[which], tier, age, &bucket, &start); age++) {
+		UART_Printf(handle, "%u %u ", age, start);
+		Cmd_PrintBucket(handle, which, &bucket);
+	}
+	return NULL;
+}
+
+static const char* Cmd_History(UART* handle, char* args)
+{
+	uint32_t from = 0, to = UINT32_MAX;
+	if (!Cmd_ParseRange(Cmd_NextToken(&args), &from, &to)) {
+		return "bad range";
+	}
+
+	// One line per sample, oldest first: index timestamp[ms] temperature pressure light.
+	uint32_t index = 0, block;
+	const SampleLog_Block* data;
+	for (block = 0; (index <= to) && ((data = SampleLog_GetBlock(&sampleHistory, block)) != NULL); block++) {
+		if ((index + data->count) <= from) {
+			index += data->count;
+			continue;
+		}
+
+		SampleLog_Reader reader;
+		SampleLog_Sample sample;
+		SampleLog_ReaderInit(&reader, data);
+		while ((index <= to) && SampleLog_Next(&reader, &sample)) {
+			if (index >= from) {
+				UART_Printf(handle, "%u %u %.2f %.3f %.3f\r\n", index, sample.timestamp,
+					Channel_ToUnit(CHANNEL_TEMPERATURE, sample.value[CHANNEL_TEMPERATURE]),
+					Channel_ToUnit(CHANNEL_PRESSURE, sample.value[CHANNEL_PRESSURE]),
+					Channel_ToUnit(CHANNEL_LIGHT, sample.value[CHANNEL_LIGHT]));
+			}
+			index++;
+		}
+	}
+	return NULL;
+}
+
+static const char* Cmd_Export(UART* handle, char* args)
+{
+	if (!handle) {
+		return "no UART";
+	}
+
+	if (exportHandle) {
+		return "export running";
+	}
+
+	// The blocks are sent by Cmd_Poll(), so the scheduled tasks go on meanwhile.
+	exportHandle  = handle;
+	exportNext    = sampleHistory.first;
+	exportEnd     = sampleHistory.first + SampleLog_BlockCount(&sampleHistory);
+	exportDelimit = true;
+	return NULL;
+}
+
+bool Cmd_Pending(void)
+{
+	return exportHandle && (UART_WriteAvailable(exportHandle) >= TELEMETRY_MAX_FRAME);
+}
+
+void Cmd_Poll(void)
+{
+	if (!Cmd_Pending()) {
+		return;
+	}
+
+	// A delimiter first, so the text sent before doesn't run into the first frame.
+	if (exportDelimit) {
+		const uint8_t delimiter = 0x00;
+		UART_Write(exportHandle, &delimiter, sizeof(delimiter));
+		exportDelimit = false;
+	}
+
+	// Blocks overwritten since the start are skipped, a block still filling is sent as it is.
+	if ((int32_t)(exportNext - sampleHistory.first) < 0) {
+		exportNext = sampleHistory.first;
+	}
+	const SampleLog_Block* data = ((int32_t)(exportEnd - exportNext) > 0)
+		? SampleLog_GetBlock(&sampleHistory, exportNext - sampleHistory.first) : NULL;
+	if (!data) {
+		exportHandle = NULL;
+		return;
+	}
+
+	uint8_t buffer[TELEMETRY_MAX_RECORD];
+	Telemetry_Block* record = (Telemetry_Block*)buffer;
+	record->type  = TELEMETRY_RECORD_BLOCK;
+	record->count = data->count;
+	memcpy(record->data, data->data, data->used);
+	Telemetry_Send(exportHandle, record, sizeof(Telemetry_Block) + data->used);
+	exportNext++;
+}
+
+static const char* Cmd_Flash(UART* handle, char* args)
+{
+	FlashLog_Status status;
+	FlashLog_GetStatus(&status);
+	if (status.size == 0) {
+		return "no flash";
+	}
+
+	char* text = Cmd_NextToken(&args);
+	if (text == NULL) {
+		UART_Printf(handle, "%u KB, %u of %u sectors used, time %u..%u s\r\n",
+			status.size / 1024, status.sectorsUsed, status.sectors, status.firstTime, status.lastTime);
+		UART_Printf(handle, "%u appended, %u overruns, %u errors\r\n",
+			status.appended, status.overruns, status.errors);
+		return NULL;
+	}
+
+	if (strcasecmp(text, "sync") == 0) {
+		FlashLog_Sync();
+		return NULL;
+	}
+
+	// One line per record: time[s] temperature pressure light.
+	uint32_t from, to;
+	if (!Cmd_ParseRange(text, &from, &to)) {
+		return "bad range";
+	}
+	FlashLog_Cursor cursor;
+	FlashLog_Record record;
+	if (FlashLog_Find(&cursor, from, to)) {
+		while (FlashLog_Next(&cursor, &record)) {
+			UART_Printf(handle, "%u %.2f %.3f %.3f\r\n", record.time,
+				Channel_ToUnit(CHANNEL_TEMPERATURE, record.temperature),
+				Channel_ToUnit(CHANNEL_PRESSURE, (int32_t)record.pressure),
+				Channel_ToUnit(CHANNEL_LIGHT, record.light));
+		}
+	}
+	return NULL;
+}
+
+static const char* Cmd_Stats(UART* handle, char* args)
+{
+	Channel_Id which;
+
+	char* text = Cmd_NextToken(&args);
+	if (text && (strcasecmp(text, "reset") == 0)) {
+		for (which = 0; which < CHANNEL_COUNT; which++) {
+			Stats_Init(&sampleStats[which]);
+		}
+		return NULL;
+	}
+	if (text) {
+		return "expected reset";
+	}
+
+	// One line per channel: name count mean stddev min max ewma(1m) ewma(15m) ewma(1h).
+	for (which = 0; which < CHANNEL_COUNT; which++) {
+		const Stats_Channel* stats = &sampleStats[which];
+		if (stats->count == 0) {
+			UART_Printf(handle, "%s 0\r\n", channelTable[which].name);
+			continue;
+		}
+
+		float_t mean = Stats_Mean(stats);
+		UART_Printf(handle, "%s %u %.3f %.3f %.3f %.3f %.3f %.3f %.3f\r\n", channelTable[which].name, stats->count,
+			Channel_ToUnit(which, mean), Channel_SpreadToUnit(which, mean, Stats_StdDev(stats)),
+			Channel_ToUnit(which, stats->min), Channel_ToUnit(which, stats->max),
+			Channel_ToUnit(which, Stats_Ewma(stats, 0)), Channel_ToUnit(which, Stats_Ewma(stats, 1)),
+			Channel_ToUnit(which, Stats_Ewma(stats, 2)));
+	}
+	return NULL;
+}
+
+static const char* Cmd_Cal(UART* handle, char* args)
+{
+	char* text = Cmd_NextToken(&args);
+	if (text == NULL) {
+		// One line per reference point: code lux, then the table in use.
+		uint32_t i;
+		for (i = 0; i < Light_CalCount(); i++) {
+			const Light_CalPoint* point = Light_CalGet(i);
+			UART_Printf(handle, "%u %u\r\n", point->code, point->lux);
+		}
+		UART_Print(handle, Light_IsCalibrated() ? "calibrated\r\n" : "default\r\n");
+		return NULL;
+	}
+
+	if (strcasecmp(text, "add") == 0) {
+		uint32_t lux;
+		if (!Cmd_ParseUInt(Cmd_NextToken(&args), &lux) || (lux > LIGHT_LUX_MAX)) {
+			return "expected lux";
+		}
+		if (!adcData) {
+			return "no light reading";
+		}
+		if (!Light_CalAdd(ADC_SAMPLE_VALUE(adcData[ADC_CHANNEL_LIGHT]), lux)) {
+			return "calibration full";
+		}
+	}
+	else if (strcasecmp(text, "apply") == 0) {
+		if (!Light_CalApply()) {
+			return "need reference points";
+		}
+	}
+	else if (strcasecmp(text, "clear") == 0) {
+		Light_CalClear();
+	}
+	else if (strcasecmp(text, "reset") == 0) {
+		Light_CalReset();
+	}
+	else {
+		return "expected add, apply, clear or reset";
+	}
+	return NULL;
+}
+
+static const char* Cmd_Tasks(UART* handle, char* args)
+{
+	char* text = Cmd_NextToken(&args);
+	if (text && (strcasecmp(text, "reset") == 0)) {
+		Scheduler_ResetStats();
+		return NULL;
+	}
+	if (text) {
+		return "expected reset";
+	}
+
+	// One line per task, in priority order: name priority period deadline runs misses worst,
+	// then the waits for an interrupt and the time spent in them [ms].
+	const Scheduler_Task* task;
+	uint32_t i;
+	for (i = 0; (task = Scheduler_TaskAt(i)) != NULL; i++) {
+		UART_Printf(handle, "%s %u %u %u %u %u %u\r\n", task->name, task->priority, task->period,
+			task->deadline, task->runs, task->misses, task->worst);
+	}
+	uint32_t sleeps, sleepMs;
+	Scheduler_GetIdle(&sleeps, &sleepMs);
+	UART_Printf(handle, "idle %u %u\r\n", sleeps, sleepMs);
+	return NULL;
+}
+
+static const char* Cmd_Cpu(UART* handle, char* args)
+{
+	static const char* const modeNames[] = { "auto", "low", "high" };
+
+	char* text = Cmd_NextToken(&args);
+	if (text) {
+		uint32_t mode;
+		for (mode = 0; mode < (sizeof(modeNames) / sizeof(modeNames[0])); mode++) {
+			if (strcasecmp(text, modeNames[mode]) == 0) {
+				Governor_SetMode((Governor_Mode)mode);
+				return NULL;
+			}
+		}
+		return "expected auto, low or high";
+	}
+
+	// The mode, one line per level: frequency [Hz] residency [ms], then the clock changes.
+	UART_Printf(handle, "%s\r\n", modeNames[Governor_GetMode()]);
+	Governor_Level level;
+	for (level = 0; level < GOVERNOR_LEVEL_COUNT; level++) {
+		UART_Printf(handle, "%u %u\r\n", Governor_Frequency(level), Governor_Residency(level));
+	}
+	UART_Printf(handle, "transitions %u\r\n", Governor_Transitions());
+	return NULL;
+}
+
+// Prints a day as integral [mmol/m2], photoperiod [min] and onset [min], the onset is - if the
+// light never came on.
+static void Cmd_PrintDay(UART* handle, const Dli_Day* day)
+{
+	if (day->onset == DLI_NO_ONSET) {
+		UART_Printf(handle, "%u %u -\r\n", day->integral, day->photoperiod);
+	}
+	else {
+		UART_Printf(handle, "%u %u %u\r\n", day->integral, day->photoperiod, day->onset);
+	}
+}
+
+static const char* Cmd_Dli(UART* handle, char* args)
+{
+	if (Cmd_NextToken(&args)) {
+		return "no arguments expected";
+	}
+
+	Dli_Day day;
+	Dli_Today(&lightDli, &day);
+	UART_Print(handle, "today ");
+	Cmd_PrintDay(handle, &day);
+
+	uint32_t age;
+	for (age = 0; Dli_Get(&lightDli, age, &day); age++) {
+		UART_Printf(handle, "d-%u ", age + 1);
+		Cmd_PrintDay(handle, &day);
+	}
+	return NULL;
+}
+
+static const char* Cmd_Mode(UART* handle, char* args)
+{
+	char* mode = Cmd_NextToken(&args);
+	if (mode == NULL) {
+		return "expected bin or text";
+	}
+
+	if (strcasecmp(mode, "bin") == 0) {
+		telemetryStream = true;
+	}
+	else if (strcasecmp(mode, "text") == 0) {
+		telemetryStream = false;
+	}
+	else {
+		return "expected bin or text";
+	}
+	return NULL;
+}
+
+static const char* Cmd_Bench(UART* handle, char* args)
+{
+	uint32_t baud, bytes = CMD_BENCH_BYTES;
+	if (!Cmd_ParseUInt(Cmd_NextToken(&args), &baud)) {
+		return "expected baud rate";
+	}
+	char* text = Cmd_NextToken(&args);
+	if (text && (!Cmd_ParseUInt(text, &bytes) || (bytes == 0))) {
+		return "bad byte count";
+	}
+	if (!handle) {
+		return "no UART";
+	}
+
+	UARTBench_Result result;
+	int32_t error = UARTBench_Run(handle, baud, bytes, &result);
+	if (error == ERROR_UNSUPPORTED) {
+		return "baud rate not supported";
+	}
+	if (error != ERROR_NONE) {
+		return "benchmark failed";
+	}
+
+	UART_Printf(handle, "baud %u, %u bytes, %u errors, %u us, %u B/s\r\n",
+		result.baud, result.bytes, result.errors, result.elapsedUs, result.bytesPerSec);
+	UART_Printf(handle, "latency min %u, avg %u, max %u us\r\n",
+		result.latencyMinUs, result.latencyAvgUs, result.latencyMaxUs);
+	return NULL;
+}
+
+void Cmd_Execute(UART* handle, char* line)
+{
+	char* next = line;
+	while (next != NULL) {
+		char* command = next;
+		next = strchr(command, ';');
+		if (next != NULL) {
+			*next++ = '\0';
+		}
+
+		char* name = Cmd_NextToken(&command);
+		if (name == NULL) {
+			continue;
+		}
+
+		const Cmd_Entry* entry = NULL;
+		uint32_t i;
+		for (i = 0; i < CMD_TABLE_SIZE; i++) {
+			if (strcasecmp(name, cmdTable[i].name) == 0) {
+				entry = &cmdTable[i];
+				break;
+			}
+		}
+
+		const char* error = entry ? entry->handler(handle, command) : "unknown command";
+		if (error) {
+			UART_Printf(handle, "ERR %s\r\n", error);
+		}
+		else {
+			UART_Print(handle, "OK\r\n");
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#ifndef CMD_H_
+#define CMD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../lib/UART.h"
+
+// Line-oriented command interface on the UI UART.
+//
+// Bytes are assembled into a line until CR or LF, so input split across RX interrupts is
+// handled. A line holds one or more commands separated by ';', e.g.
+//
+//     set interval=5 logsize=10; get temp.log 0..9
+//
+// Every command answers with its output followed by "OK" or "ERR <reason>".
+
+/// <summary>Longest accepted line, without the terminator.</summary>
+#define CMD_LINE_MAX 128
+
+/// <summary>Entry of the command table.</summary>
+typedef struct {
+	const char* name;
+	const char* usage;
+	/// <summary>Runs the command, returns NULL on success or a reason for the failure.</summary>
+	const char* (*handler)(UART* handle, char* args);
+} Cmd_Entry;
+
+/// <summary>Returns true when no partial line has been received.</summary>
+bool Cmd_LineEmpty(void);
+
+/// <summary>
+/// <para>Adds a received byte to the line buffer. Printable bytes are echoed and backspace
+/// removes the last byte.</para>
+/// </summary>
+/// <param name="echo">UART to echo to, may be NULL.</param>
+/// <param name="c">Received byte.</param>
+/// <returns>The complete line once a terminator is received, otherwise NULL. The line stays
+/// valid until the next call.</returns>
+char* Cmd_LineAppend(UART* echo, uint8_t c);
+
+/// <summary>
+/// <para>Runs every ';' separated command of a line. The line is modified.</para>
+/// </summary>
+/// <param name="handle">UART to answer on, may be NULL to run silently.</param>
+/// <param name="line">Null-terminated line.</param>
+void Cmd_Execute(UART* handle, char* line);
+
+/// <summary>
+/// <para>Sends the next block of a running export if the UART has room for it. Call from the
+/// main loop.</para>
+/// </summary>
+void Cmd_Poll(void);
+
+/// <summary>Returns true if Cmd_Poll() has a block to send and room for it.</summary>
+bool Cmd_Pending(void);
+
+#endif // #ifndef CMD_H_
@@ -0,0 +1,108 @@
+#include "dli.h"
+
+#define DLI_NO_ONSET_TICK UINT32_MAX
+
+static void Dli_Open(Dli_Store* store)
+{
+	store->sum        = 0;
+	store->tick       = 0;
+	store->lightTicks = 0;
+	store->onsetTick  = store->light ? 0 : DLI_NO_ONSET_TICK;
+}
+
+static void Dli_Summarise(const Dli_Store* store, Dli_Day* day)
+{
+	uint32_t ticksPerMinute = store->tickRate * 60;
+	day->integral    = (uint32_t)(store->sum / ((uint64_t)store->tickRate * 1000));
+	day->photoperiod = (uint16_t)((store->lightTicks + (ticksPerMinute / 2)) / ticksPerMinute);
+	day->onset       = (store->onsetTick == DLI_NO_ONSET_TICK)
+		? DLI_NO_ONSET : (uint16_t)(store->onsetTick / ticksPerMinute);
+}
+
+static void Dli_Close(Dli_Store* store)
+{
+	Dli_Summarise(store, &store->days[store->closed % DLI_HISTORY_DAYS]);
+	store->closed++;
+	Dli_Open(store);
+}
+
+void Dli_Init(Dli_Store* store, uint32_t tickRate)
+{
+	*store = (Dli_Store){ .tickRate = tickRate };
+	Dli_Open(store);
+}
+
+void Dli_Add(Dli_Store* store, uint32_t ppfd, uint32_t ticks)
+{
+	if (store->tickRate == 0) {
+		return;
+	}
+
+	bool light = store->light ? (ppfd >= (DLI_PHOTOPERIOD_PPFD / 2)) : (ppfd >= DLI_PHOTOPERIOD_PPFD);
+	if (light && !store->light && (store->onsetTick == DLI_NO_ONSET_TICK)) {
+		store->onsetTick = store->tick;
+	}
+	store->light = light;
+
+	// Split the reading at midnight; it only loops again for a reading longer than a day.
+	uint32_t dayTicks = store->tickRate * DLI_DAY_SECONDS;
+	while (ticks > 0) {
+		uint32_t step = dayTicks - store->tick;
+		if (step > ticks) {
+			step = ticks;
+		}
+		store->sum += (uint64_t)ppfd * step;
+		if (light) {
+			store->lightTicks += step;
+		}
+		store->tick += step;
+		ticks -= step;
+
+		if (store->tick >= dayTicks) {
+			Dli_Close(store);
+		}
+	}
+}
+
+bool Dli_SetClock(Dli_Store* store, uint32_t seconds)
+{
+	if ((store->tickRate == 0) || (seconds >= DLI_DAY_SECONDS)) {
+		return false;
+	}
+
+	// The onset keeps its place in the day, an onset before the new midnight moves to it.
+	uint32_t tick = seconds * store->tickRate;
+	if (store->onsetTick != DLI_NO_ONSET_TICK) {
+		store->onsetTick = (store->onsetTick + tick > store->tick) ? (store->onsetTick + tick - store->tick) : 0;
+	}
+	store->tick = tick;
+	return true;
+}
+
+uint32_t Dli_Clock(const Dli_Store* store)
+{
+	return (store->tickRate == 0) ? 0 : (store->tick / store->tickRate);
+}
+
+void Dli_Today(const Dli_Store* store, Dli_Day* day)
+{
+	if (store->tickRate == 0) {
+		*day = (Dli_Day){ .onset = DLI_NO_ONSET };
+		return;
+	}
+	Dli_Summarise(store, day);
+}
+
+bool Dli_Get(const Dli_Store* store, uint32_t age, Dli_Day* day)
+{
+	if ((age >= DLI_HISTORY_DAYS) || (age >= store->closed)) {
+		return false;
+	}
+	*day = store->days[(store->closed - 1 - age) % DLI_HISTORY_DAYS];
+	return true;
+}
+
+uint32_t Dli_DaysClosed(const Dli_Store* store)
+{
+	return store->closed;
+}
@@ -0,0 +1,96 @@
+#ifndef DLI_H_
+#define DLI_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Daily light integral and photoperiod of the ambient light.
+//
+// Every light reading is added with the time it stands for, counted in ticks of a fixed rate
+// (the ADC scan rate), so an update is one multiply-add whatever the reading rate. When the
+// day closes, its integral and photoperiod are stored in a ring of DLI_HISTORY_DAYS days.
+//
+// The core has no wall clock: days are counted from boot until Dli_SetClock() aligns them to
+// local midnight.
+
+/// <summary>Closed days kept.</summary>
+#define DLI_HISTORY_DAYS 7
+
+#define DLI_DAY_SECONDS 86400
+
+/// <summary>PPFD at which the light counts as on [umol/m2/s]; it counts as off again below
+/// half of it, so a reading hovering at the threshold doesn't split the photoperiod.</summary>
+#ifndef DLI_PHOTOPERIOD_PPFD
+#define DLI_PHOTOPERIOD_PPFD 10
+#endif
+
+/// <summary>Onset of a day in which the light never came on.</summary>
+#define DLI_NO_ONSET 0xFFFF
+
+typedef struct {
+	/// <summary>Integral of the PPFD over the day [mmol/m2].</summary>
+	uint32_t integral;
+	/// <summary>Time the light was on [min].</summary>
+	uint16_t photoperiod;
+	/// <summary>Time of day the light first came on [min], or DLI_NO_ONSET.</summary>
+	uint16_t onset;
+} Dli_Day;
+
+typedef struct {
+	/// <summary>PPFD summed over the ticks of the open day [umol/m2/s * tick].</summary>
+	uint64_t sum;
+	/// <summary>Ticks since the start of the open day.</summary>
+	uint32_t tick;
+	uint32_t lightTicks;
+	uint32_t onsetTick;
+	uint32_t tickRate;
+	/// <summary>Number of days closed, free-running.</summary>
+	uint32_t closed;
+	bool     light;
+	Dli_Day  days[DLI_HISTORY_DAYS];
+} Dli_Store;
+
+/// <summary>
+/// <para>Clears a store and starts a day.</para>
+/// </summary>
+/// <param name="store">Store to clear.</param>
+/// <param name="tickRate">Ticks per second of the times passed to Dli_Add(), at most
+/// 49710 so a day fits in 32 bits.</param>
+void Dli_Init(Dli_Store* store, uint32_t tickRate);
+
+/// <summary>
+/// <para>Adds a reading, closing the day when it runs past midnight.</para>
+/// </summary>
+/// <param name="store">Store to update.</param>
+/// <param name="ppfd">Photosynthetic photon flux density [umol/m2/s].</param>
+/// <param name="ticks">Time the reading stands for [ticks].</param>
+void Dli_Add(Dli_Store* store, uint32_t ppfd, uint32_t ticks);
+
+/// <summary>
+/// <para>Sets the time of day, so following days close at local midnight. The open day
+/// keeps what it has accumulated and becomes longer or shorter.</para>
+/// </summary>
+/// <param name="store">Store to update.</param>
+/// <param name="seconds">Time since midnight [s].</param>
+/// <returns>false if seconds is not within a day.</returns>
+bool Dli_SetClock(Dli_Store* store, uint32_t seconds);
+
+/// <summary>Returns the time of day [s].</summary>
+uint32_t Dli_Clock(const Dli_Store* store);
+
+/// <summary>Reads the open day, as accumulated so far.</summary>
+void Dli_Today(const Dli_Store* store, Dli_Day* day);
+
+/// <summary>
+/// <para>Reads a closed day.</para>
+/// </summary>
+/// <param name="store">Store to read.</param>
+/// <param name="age">0 for yesterday.</param>
+/// <param name="day">Receives the day.</param>
+/// <returns>false if the day doesn't exist (yet).</returns>
+bool Dli_Get(const Dli_Store* store, uint32_t age, Dli_Day* day);
+
+/// <summary>Returns the number of days closed since Dli_Init().</summary>
+uint32_t Dli_DaysClosed(const Dli_Store* store);
+
+#endif // #ifndef DLI_H_
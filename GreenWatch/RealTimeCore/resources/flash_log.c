@@ -0,0 +1,721 @@
+#include "flash_log.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "../lib/GPIO.h"
+#include "../lib/NVIC.h"
+#include "../lib/SPIMaster.h"
+
+#define FLASH_CMD_PROGRAM      0x02
+#define FLASH_CMD_READ         0x03
+#define FLASH_CMD_READ_STATUS  0x05
+#define FLASH_CMD_WRITE_ENABLE 0x06
+#define FLASH_CMD_ERASE_SECTOR 0x20
+#define FLASH_CMD_READ_ID      0x9F
+
+#define FLASH_STATUS_BUSY 0x01
+
+// Time between status polls of an erase or program [ms]. A page program takes about a
+// millisecond and an erase tens of them, polling back to back would keep the core awake.
+#define FLASH_LOG_POLL_MS 1
+
+#define FLASH_LOG_MAGIC 0x314C5747 // "GWL1"
+#define FLASH_LOG_EMPTY 0xFFFFFFFF
+
+// Bytes of command and address in front of a read or program.
+#define FLASH_LOG_COMMAND_SIZE 4
+
+// The SPI unit moves at most 4 opcode and 16 data bytes per glob and 16 globs per sequence,
+// so a page program is split in 20 byte write transfers and a read in 16 byte read transfers.
+#define FLASH_LOG_WRITE_CHUNK 20
+#define FLASH_LOG_READ_CHUNK  16
+#define FLASH_LOG_READ_MAX    256
+
+#define FLASH_LOG_PROGRAM_TRANSFERS \
+	((FLASH_LOG_COMMAND_SIZE + FLASH_LOG_PAGE_SIZE + FLASH_LOG_WRITE_CHUNK - 1) / FLASH_LOG_WRITE_CHUNK)
+
+typedef struct __attribute__((__packed__)) {
+	uint32_t magic;
+	/// <summary>Incremented for every sector started, the highest one is the newest sector.</summary>
+	uint32_t sequence;
+	uint32_t reserved;
+	uint16_t reserved2;
+	uint16_t crc;
+} FlashLog_Header;
+
+_Static_assert(sizeof(FlashLog_Record) == 16, "FlashLog_Record must be 16 bytes");
+_Static_assert(sizeof(FlashLog_Header) == sizeof(FlashLog_Record), "FlashLog_Header must fill one record slot");
+_Static_assert((FLASH_LOG_SECTOR_SIZE % sizeof(FlashLog_Record)) == 0, "Records must tile a sector");
+
+#define FLASH_LOG_RECORDS ((FLASH_LOG_SECTOR_SIZE - sizeof(FlashLog_Header)) / sizeof(FlashLog_Record))
+
+typedef enum {
+	FLASH_PAGE_FREE,
+	FLASH_PAGE_FILLING,
+	FLASH_PAGE_READY,
+	FLASH_PAGE_WRITING,
+} FlashLog_PageState;
+
+typedef struct {
+	/// <summary>Program command and address followed by the page data.</summary>
+	uint8_t  frame[FLASH_LOG_COMMAND_SIZE + FLASH_LOG_PAGE_SIZE];
+	/// <summary>Flash address of the first data byte.</summary>
+	uint32_t address;
+	uint32_t length;
+	/// <summary>The page starts a sector: erase it first, then index it.</summary>
+	bool     header;
+	bool     erased;
+	uint32_t firstTime;
+	volatile FlashLog_PageState state;
+} FlashLog_Page;
+
+typedef enum {
+	FLASH_IDLE,
+	FLASH_WRITE_ENABLE,
+	FLASH_COMMAND,
+	FLASH_WAIT,
+	FLASH_POLL,
+} FlashLog_State;
+
+static SPIMaster* flashSpi = NULL;
+static uint32_t flashSectors = 0;
+
+// Time of the first record of every sector, FLASH_LOG_EMPTY for sectors without records.
+// The index and flashPersisted are updated from the SPI interrupt as pages complete, the main
+// loop reads them with the interrupts blocked or once the writes are idle.
+static SYSRAM_DATA uint32_t flashIndex[FLASH_LOG_MAX_SECTORS];
+static uint32_t flashOldest = 0;
+static uint32_t flashUsed = 0;
+static uint32_t flashSequence = 0;
+
+// Address of the next record, and the end of the data programmed so far.
+static uint32_t flashWrite = 0;
+static uint32_t flashPersisted = 0;
+
+static uint32_t flashTimeBase = 0;
+static uint32_t flashLastTime = 0;
+
+static uint32_t flashAppended = 0;
+static uint32_t flashOverruns = 0;
+static uint32_t flashErrors = 0;
+
+// Pages are filled and written alternately, so they reach the flash in order.
+static SYSRAM_DATA FlashLog_Page flashPages[2];
+static uint32_t flashFill = 0;
+static uint32_t flashDrain = 0;
+
+// The SPI driver keeps pointers to the transfers until the sequence completes.
+static volatile FlashLog_State flashState = FLASH_IDLE;
+static const uint8_t flashWriteEnable = FLASH_CMD_WRITE_ENABLE;
+static const uint8_t flashReadStatus = FLASH_CMD_READ_STATUS;
+static uint8_t flashStatus;
+static uint8_t flashErase[FLASH_LOG_COMMAND_SIZE];
+static SPITransfer flashWriteEnableTransfer[1];
+static SPITransfer flashCommandTransfer[FLASH_LOG_PROGRAM_TRANSFERS];
+static SPITransfer flashPollTransfer[2];
+
+// Time of the next status poll, set by the main loop once it sees FLASH_WAIT: the interrupt
+// entering it can't read the clock.
+static bool flashPollArmed = false;
+static uint32_t flashPollAt = 0;
+
+static void FlashLog_Callback(int32_t status, uintptr_t count);
+
+static void FlashLog_Select(SPIMaster* handle, bool select)
+{
+	(void)handle;
+	GPIO_Write(FLASH_LOG_CS_GPIO, !select);
+}
+
+static void FlashLog_SetAddress(uint8_t* command, uint8_t opcode, uint32_t address)
+{
+	command[0] = opcode;
+	command[1] = (uint8_t)(address >> 16);
+	command[2] = (uint8_t)(address >> 8);
+	command[3] = (uint8_t)address;
+}
+
+static bool FlashLog_RecordValid(const FlashLog_Record* record)
+{
+	return (record->crc == Telemetry_Crc16((const uint8_t*)record, sizeof(*record) - sizeof(record->crc)));
+}
+
+static bool FlashLog_HeaderValid(const FlashLog_Header* header)
+{
+	return (header->magic == FLASH_LOG_MAGIC)
+		&& (header->crc == Telemetry_Crc16((const uint8_t*)header, sizeof(*header) - sizeof(header->crc)));
+}
+
+static uint32_t FlashLog_Address(uint32_t sector, uint32_t slot)
+{
+	return (sector * FLASH_LOG_SECTOR_SIZE) + sizeof(FlashLog_Header) + (slot * sizeof(FlashLog_Record));
+}
+
+// Background writes --------------------------------------------------------------------------
+
+static void FlashLog_Transfer(SPITransfer* transfer, uint32_t count, FlashLog_State next);
+
+static void FlashLog_Command(FlashLog_Page* page)
+{
+	if (!page->erased) {
+		FlashLog_SetAddress(flashErase, FLASH_CMD_ERASE_SECTOR, page->address);
+		flashCommandTransfer[0] = (SPITransfer){ .writeData = flashErase, .readData = NULL, .length = sizeof(flashErase) };
+		FlashLog_Transfer(flashCommandTransfer, 1, FLASH_COMMAND);
+		return;
+	}
+
+	FlashLog_SetAddress(page->frame, FLASH_CMD_PROGRAM, page->address);
+	uint32_t size = FLASH_LOG_COMMAND_SIZE + page->length;
+	uint32_t count = 0, offset;
+	for (offset = 0; offset < size; offset += FLASH_LOG_WRITE_CHUNK) {
+		uint32_t length = size - offset;
+		flashCommandTransfer[count++] = (SPITransfer){
+			.writeData = &page->frame[offset],
+			.readData  = NULL,
+			.length    = (length > FLASH_LOG_WRITE_CHUNK ? FLASH_LOG_WRITE_CHUNK : length),
+		};
+	}
+	FlashLog_Transfer(flashCommandTransfer, count, FLASH_COMMAND);
+}
+
+static void FlashLog_StartPage(void)
+{
+	FlashLog_Page* page = &flashPages[flashDrain];
+	if (page->state != FLASH_PAGE_READY) {
+		flashState = FLASH_IDLE;
+		return;
+	}
+
+	page->state  = FLASH_PAGE_WRITING;
+	page->erased = !page->header;
+	FlashLog_Transfer(flashWriteEnableTransfer, 1, FLASH_WRITE_ENABLE);
+}
+
+static void FlashLog_PageFree(void)
+{
+	flashPages[flashDrain].state = FLASH_PAGE_FREE;
+	flashDrain ^= 1;
+}
+
+static void FlashLog_PageDone(void)
+{
+	FlashLog_Page* page = &flashPages[flashDrain];
+
+	if (page->header) {
+		uint32_t sector = page->address / FLASH_LOG_SECTOR_SIZE;
+		if (flashUsed == 0) {
+			flashOldest = sector;
+			flashUsed = 1;
+		}
+		else if (flashUsed < flashSectors) {
+			flashUsed++;
+		}
+		else {
+			flashOldest = (flashOldest + 1) % flashSectors;
+		}
+		flashIndex[sector] = page->firstTime;
+	}
+
+	flashPersisted = page->address + page->length;
+	if (flashPersisted >= (flashSectors * FLASH_LOG_SECTOR_SIZE)) {
+		flashPersisted = 0;
+	}
+
+	FlashLog_PageFree();
+}
+
+static void FlashLog_Transfer(SPITransfer* transfer, uint32_t count, FlashLog_State next)
+{
+	// The callback can run before the call returns.
+	flashState = next;
+	if (SPIMaster_TransferSequentialAsync(flashSpi, transfer, count, FlashLog_Callback) != ERROR_NONE) {
+		FlashLog_Callback(ERROR, 0);
+	}
+}
+
+static void FlashLog_Callback(int32_t status, uintptr_t count)
+{
+	(void)count;
+
+	if (status != ERROR_NONE) {
+		// Give up on the page, its records are lost. Neither the sector nor the persisted end
+		// move, so a header that never reached the flash isn't indexed.
+		flashErrors++;
+		FlashLog_PageFree();
+		flashState = FLASH_IDLE;
+		return;
+	}
+
+	FlashLog_Page* page = &flashPages[flashDrain];
+	switch (flashState) {
+	case FLASH_WRITE_ENABLE:
+		FlashLog_Command(page);
+		break;
+
+	case FLASH_COMMAND:
+		// Erase and program take milliseconds, the status is polled from the main loop.
+		flashState = FLASH_WAIT;
+		break;
+
+	case FLASH_POLL:
+		if (flashStatus & FLASH_STATUS_BUSY) {
+			flashState = FLASH_WAIT;
+		}
+		else if (!page->erased) {
+			page->erased = true;
+			FlashLog_Transfer(flashWriteEnableTransfer, 1, FLASH_WRITE_ENABLE);
+		}
+		else {
+			FlashLog_PageDone();
+			FlashLog_StartPage();
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+static inline bool FlashLog_PollDue(void)
+{
+	return ((int32_t)(uptimeMs - flashPollAt) >= 0);
+}
+
+// Polls the status of a pending erase or program at once, or only once it's due if timed.
+static void FlashLog_Advance(bool timed)
+{
+	if (!flashSpi) {
+		return;
+	}
+
+	// Only the main loop leaves these states, so there's no transfer in flight to race with.
+	if (flashState == FLASH_WAIT) {
+		if (timed && !flashPollArmed) {
+			// uptimeMs counts whole ms, one more makes sure a full period passes.
+			flashPollAt = uptimeMs + FLASH_LOG_POLL_MS + 1;
+			flashPollArmed = true;
+		}
+		else if (!timed || FlashLog_PollDue()) {
+			flashPollArmed = false;
+			FlashLog_Transfer(flashPollTransfer, 2, FLASH_POLL);
+		}
+	}
+	else if (flashState == FLASH_IDLE) {
+		FlashLog_StartPage();
+	}
+}
+
+void FlashLog_Poll(void)
+{
+	FlashLog_Advance(true);
+}
+
+uint32_t FlashLog_IdleLimit(void)
+{
+	if (!flashSpi) {
+		return UINT32_MAX;
+	}
+	if (flashState == FLASH_WAIT) {
+		if (!flashPollArmed || FlashLog_PollDue()) {
+			return 0;
+		}
+		return flashPollAt - uptimeMs;
+	}
+	if ((flashState == FLASH_IDLE) && (flashPages[flashDrain].state == FLASH_PAGE_READY)) {
+		return 0;
+	}
+	return UINT32_MAX;
+}
+
+static void FlashLog_WaitIdle(void)
+{
+	for (;;) {
+		// Nothing but the SPI interrupt wakes the wfi below, so the status is polled untimed.
+		FlashLog_Advance(false);
+		if (flashState == FLASH_IDLE) {
+			return;
+		}
+		__asm__("wfi");
+	}
+}
+
+// Appending ----------------------------------------------------------------------------------
+
+static void FlashLog_OpenPage(FlashLog_Page* page, uint32_t time)
+{
+	page->address = flashWrite;
+	page->length  = 0;
+	page->header  = ((flashWrite % FLASH_LOG_SECTOR_SIZE) == 0);
+
+	if (page->header) {
+		FlashLog_Header header = {
+			.magic     = FLASH_LOG_MAGIC,
+			.sequence  = ++flashSequence,
+			.reserved  = 0xFFFFFFFF,
+			.reserved2 = 0xFFFF,
+		};
+		header.crc = Telemetry_Crc16((const uint8_t*)&header, sizeof(header) - sizeof(header.crc));
+		__builtin_memcpy(&page->frame[FLASH_LOG_COMMAND_SIZE], &header, sizeof(header));
+
+		page->length    = sizeof(header);
+		page->firstTime = time;
+		flashWrite     += sizeof(header);
+	}
+
+	page->state = FLASH_PAGE_FILLING;
+}
+
+static void FlashLog_ClosePage(void)
+{
+	flashPages[flashFill].state = FLASH_PAGE_READY;
+	flashFill ^= 1;
+}
+
+bool FlashLog_Append(const SampleLog_Sample* sample)
+{
+	if (!flashSpi) {
+		return false;
+	}
+
+	FlashLog_Page* page = &flashPages[flashFill];
+	uint32_t time = flashTimeBase + (sample->timestamp / 1000);
+
+	if (page->state != FLASH_PAGE_FILLING) {
+		if (page->state != FLASH_PAGE_FREE) {
+			flashOverruns++;
+			return false;
+		}
+		FlashLog_OpenPage(page, time);
+	}
+
+	FlashLog_Record record = {
+		.time        = time,
+		.pressure    = (uint32_t)sample->value[CHANNEL_PRESSURE],
+		.temperature = (int16_t)sample->value[CHANNEL_TEMPERATURE],
+		.light       = (uint16_t)sample->value[CHANNEL_LIGHT],
+		.reserved    = 0xFFFF,
+	};
+	record.crc = Telemetry_Crc16((const uint8_t*)&record, sizeof(record) - sizeof(record.crc));
+	__builtin_memcpy(&page->frame[FLASH_LOG_COMMAND_SIZE + page->length], &record, sizeof(record));
+
+	page->length += sizeof(record);
+	flashWrite   += sizeof(record);
+	if (flashWrite >= (flashSectors * FLASH_LOG_SECTOR_SIZE)) {
+		flashWrite = 0;
+	}
+	flashLastTime = time;
+	flashAppended++;
+
+	if (((page->address + page->length) % FLASH_LOG_PAGE_SIZE) == 0) {
+		FlashLog_ClosePage();
+	}
+	return true;
+}
+
+void FlashLog_Sync(void)
+{
+	FlashLog_Page* page = &flashPages[flashFill];
+	if ((page->state == FLASH_PAGE_FILLING) && (page->length > 0)) {
+		FlashLog_ClosePage();
+	}
+	FlashLog_Poll();
+}
+
+void FlashLog_GetStatus(FlashLog_Status* status)
+{
+	uint32_t prevBasePri = NVIC_BlockIRQs();
+	*status = (FlashLog_Status){
+		.size        = flashSectors * FLASH_LOG_SECTOR_SIZE,
+		.sectors     = flashSectors,
+		.sectorsUsed = flashUsed,
+		.firstTime   = (flashUsed > 0 ? flashIndex[flashOldest] : 0),
+		.lastTime    = flashLastTime,
+		.appended    = flashAppended,
+		.overruns    = flashOverruns,
+		.errors      = flashErrors,
+	};
+	NVIC_RestoreIRQs(prevBasePri);
+}
+
+// Reading ------------------------------------------------------------------------------------
+
+static int32_t FlashLog_Read(uint32_t address, void* data, uint32_t length)
+{
+	FlashLog_WaitIdle();
+
+	uint8_t* dst = data;
+	while (length > 0) {
+		uint32_t size = (length > FLASH_LOG_READ_MAX ? FLASH_LOG_READ_MAX : length);
+
+		uint8_t command[FLASH_LOG_COMMAND_SIZE];
+		FlashLog_SetAddress(command, FLASH_CMD_READ, address);
+
+		SPITransfer transfer[1 + (FLASH_LOG_READ_MAX / FLASH_LOG_READ_CHUNK)];
+		transfer[0] = (SPITransfer){ .writeData = command, .readData = NULL, .length = sizeof(command) };
+		uint32_t count = 1, offset;
+		for (offset = 0; offset < size; offset += FLASH_LOG_READ_CHUNK) {
+			uint32_t chunk = size - offset;
+			transfer[count++] = (SPITransfer){
+				.writeData = NULL,
+				.readData  = &dst[offset],
+				.length    = (chunk > FLASH_LOG_READ_CHUNK ? FLASH_LOG_READ_CHUNK : chunk),
+			};
+		}
+
+		int32_t status = SPIMaster_TransferSequentialSync(flashSpi, transfer, count);
+		if (status != ERROR_NONE) {
+			return status;
+		}
+
+		address += size;
+		dst     += size;
+		length  -= size;
+	}
+	return ERROR_NONE;
+}
+
+static uint32_t FlashLog_SlotTime(uint32_t sector, uint32_t slot)
+{
+	FlashLog_Record record;
+	if (FlashLog_Read(FlashLog_Address(sector, slot), &record, sizeof(record)) != ERROR_NONE) {
+		return FLASH_LOG_EMPTY;
+	}
+	return record.time;
+}
+
+static uint32_t FlashLog_Sector(uint32_t age)
+{
+	return (flashOldest + age) % flashSectors;
+}
+
+bool FlashLog_Find(FlashLog_Cursor* cursor, uint32_t from, uint32_t to)
+{
+	if (!flashSpi) {
+		return false;
+	}
+	FlashLog_WaitIdle();
+	if ((flashUsed == 0) || (from > to)) {
+		return false;
+	}
+
+	// Newest sector starting at or before from, then the first record at or after it.
+	uint32_t lo = 0, hi = flashUsed - 1;
+	while (lo < hi) {
+		uint32_t mid = (lo + hi + 1) / 2;
+		if (flashIndex[FlashLog_Sector(mid)] <= from) {
+			lo = mid;
+		}
+		else {
+			hi = mid - 1;
+		}
+	}
+	cursor->sector = lo;
+
+	uint32_t sector = FlashLog_Sector(lo);
+	lo = 0;
+	hi = FLASH_LOG_RECORDS;
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+		if (FlashLog_SlotTime(sector, mid) < from) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	cursor->slot       = lo;
+	cursor->to         = to;
+	cursor->cacheCount = 0;
+	return true;
+}
+
+bool FlashLog_Next(FlashLog_Cursor* cursor, FlashLog_Record* record)
+{
+	const uint32_t cacheSize = sizeof(cursor->cache) / sizeof(cursor->cache[0]);
+
+	// With no page in flight the index can't change under the cursor.
+	FlashLog_WaitIdle();
+	while (cursor->sector < flashUsed) {
+		if (cursor->slot >= FLASH_LOG_RECORDS) {
+			cursor->sector++;
+			cursor->slot = 0;
+			continue;
+		}
+
+		uint32_t sector = FlashLog_Sector(cursor->sector);
+		if (FlashLog_Address(sector, cursor->slot) == flashPersisted) {
+			break;
+		}
+
+		if ((cursor->cacheCount == 0) || (cursor->cacheSector != cursor->sector)
+			|| (cursor->slot < cursor->cacheSlot) || (cursor->slot >= (cursor->cacheSlot + cursor->cacheCount))) {
+			uint32_t count = FLASH_LOG_RECORDS - cursor->slot;
+			if (count > cacheSize) {
+				count = cacheSize;
+			}
+			if (FlashLog_Read(FlashLog_Address(sector, cursor->slot), cursor->cache,
+				count * sizeof(FlashLog_Record)) != ERROR_NONE) {
+				break;
+			}
+			cursor->cacheSector = cursor->sector;
+			cursor->cacheSlot   = cursor->slot;
+			cursor->cacheCount  = count;
+		}
+
+		*record = cursor->cache[cursor->slot - cursor->cacheSlot];
+		cursor->slot++;
+
+		if (!FlashLog_RecordValid(record)) {
+			continue;
+		}
+		if (record->time > cursor->to) {
+			break;
+		}
+		return true;
+	}
+
+	cursor->sector = flashUsed;
+	return false;
+}
+
+// Mounting -----------------------------------------------------------------------------------
+
+static bool FlashLog_SlotErased(uint32_t sector, uint32_t slot)
+{
+	FlashLog_Record record;
+	if (FlashLog_Read(FlashLog_Address(sector, slot), &record, sizeof(record)) != ERROR_NONE) {
+		return false;
+	}
+
+	const uint8_t* bytes = (const uint8_t*)&record;
+	uint32_t i;
+	for (i = 0; i < sizeof(record); i++) {
+		if (bytes[i] != 0xFF) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static XIP_CODE int32_t FlashLog_Mount(void)
+{
+	uint32_t newest = 0, sector;
+	bool found = false;
+
+	flashUsed = 0;
+	for (sector = 0; sector < flashSectors; sector++) {
+		struct __attribute__((__packed__)) {
+			FlashLog_Header header;
+			FlashLog_Record first;
+		} start;
+		int32_t status = FlashLog_Read(sector * FLASH_LOG_SECTOR_SIZE, &start, sizeof(start));
+		if (status != ERROR_NONE) {
+			return status;
+		}
+
+		flashIndex[sector] = FLASH_LOG_EMPTY;
+		if (!FlashLog_HeaderValid(&start.header) || !FlashLog_RecordValid(&start.first)) {
+			continue;
+		}
+		flashIndex[sector] = start.first.time;
+		flashUsed++;
+
+		if (!found || ((int32_t)(start.header.sequence - flashSequence) > 0)) {
+			flashSequence = start.header.sequence;
+			newest = sector;
+			found = true;
+		}
+	}
+
+	if (!found) {
+		flashOldest    = 0;
+		flashWrite     = 0;
+		flashPersisted = 0;
+		flashTimeBase  = 0;
+		return ERROR_NONE;
+	}
+
+	// Sectors are written in a circle, so the oldest one follows the newest.
+	flashOldest = (newest + 1) % flashSectors;
+	while (flashIndex[flashOldest] == FLASH_LOG_EMPTY) {
+		flashOldest = (flashOldest + 1) % flashSectors;
+	}
+
+	// Records are appended in order, so the erased slots of the newest sector are a suffix.
+	uint32_t lo = 1, hi = FLASH_LOG_RECORDS;
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+		if (FlashLog_SlotErased(newest, mid)) {
+			hi = mid;
+		}
+		else {
+			lo = mid + 1;
+		}
+	}
+
+	FlashLog_Record last;
+	flashLastTime = flashIndex[newest];
+	if ((FlashLog_Read(FlashLog_Address(newest, lo - 1), &last, sizeof(last)) == ERROR_NONE)
+		&& FlashLog_RecordValid(&last)) {
+		flashLastTime = last.time;
+	}
+	flashTimeBase = flashLastTime + 1;
+
+	flashWrite = (lo < FLASH_LOG_RECORDS ? FlashLog_Address(newest, lo)
+		: (((newest + 1) % flashSectors) * FLASH_LOG_SECTOR_SIZE));
+	flashPersisted = flashWrite;
+	return ERROR_NONE;
+}
+
+XIP_CODE int32_t FlashLog_Init(Platform_Unit unit)
+{
+	SPIMaster* spi = SPIMaster_Open(unit);
+	if (!spi) {
+		return ERROR;
+	}
+
+	GPIO_ConfigurePinForOutput(FLASH_LOG_CS_GPIO);
+	GPIO_Write(FLASH_LOG_CS_GPIO, true);
+
+	int32_t status = SPIMaster_SetSelectLineCallback(spi, FlashLog_Select);
+	if (status == ERROR_NONE) {
+		status = SPIMaster_Configure(spi, false, false, FLASH_LOG_SPI_SPEED);
+	}
+	if (status == ERROR_NONE) {
+		status = SPIMaster_DMAEnable(spi, true);
+	}
+
+	uint8_t id[3] = { 0 };
+	if (status == ERROR_NONE) {
+		const uint8_t command = FLASH_CMD_READ_ID;
+		status = SPIMaster_WriteThenReadSync(spi, &command, sizeof(command), id, sizeof(id));
+	}
+
+	// JEDEC ID: manufacturer, type, log2 of the size in bytes. 3 byte addresses reach 16 MB.
+	if ((status == ERROR_NONE) && ((id[0] == 0x00) || (id[0] == 0xFF) || (id[2] < 16) || (id[2] > 24))) {
+		status = ERROR_UNSUPPORTED;
+	}
+	if (status != ERROR_NONE) {
+		SPIMaster_Close(spi);
+		return status;
+	}
+
+	flashSectors = (1U << id[2]) / FLASH_LOG_SECTOR_SIZE;
+	if (flashSectors > FLASH_LOG_MAX_SECTORS) {
+		flashSectors = FLASH_LOG_MAX_SECTORS;
+	}
+
+	flashWriteEnableTransfer[0] = (SPITransfer){ .writeData = &flashWriteEnable, .readData = NULL, .length = 1 };
+	flashPollTransfer[0] = (SPITransfer){ .writeData = &flashReadStatus, .readData = NULL, .length = 1 };
+	flashPollTransfer[1] = (SPITransfer){ .writeData = NULL, .readData = &flashStatus, .length = 1 };
+	flashPages[0].state = FLASH_PAGE_FREE;
+	flashPages[1].state = FLASH_PAGE_FREE;
+	flashState = FLASH_IDLE;
+
+	flashSpi = spi;
+	status = FlashLog_Mount();
+	if (status != ERROR_NONE) {
+		flashSpi = NULL;
+		SPIMaster_Close(spi);
+	}
+	return status;
+}
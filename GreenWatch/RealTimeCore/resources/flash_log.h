@@ -0,0 +1,143 @@
+#ifndef FLASH_LOG_H_
+#define FLASH_LOG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../lib/Platform.h"
+#include "sample_log.h"
+
+// Append-only sample log on an external SPI NOR flash (JEDEC commands, 3 byte addresses,
+// 4 KB sectors, 256 byte pages).
+//
+// The flash is written as a circular sequence of sectors, so every sector is erased once per
+// pass and wear is spread evenly. Each sector starts with a header carrying an increasing
+// sequence number, which finds the newest sector on mount, followed by fixed size records
+// with their own CRC. A RAM index holds the time of the first record of every sector, so a
+// time range is found with a binary search over the sectors and then within one sector.
+//
+// Records are collected in RAM and programmed a page at a time. Erase, program and status
+// polls are DMA transfers chained from the SPI interrupt and FlashLog_Poll(), so sampling
+// never waits for the flash. Up to one page of records is lost on power loss, see
+// FlashLog_Sync().
+//
+// The chip select is a GPIO rather than the ISU CS line: a page program needs more than one
+// SPI transfer and the hardware CS is released after each one.
+//
+// Record times are seconds of logged operation: on mount they continue from the newest record
+// in the flash, so they increase across resets.
+
+/// <summary>GPIO driving the flash /CS line.</summary>
+#ifndef FLASH_LOG_CS_GPIO
+#define FLASH_LOG_CS_GPIO 16
+#endif
+
+/// <summary>SPI clock [Hz].</summary>
+#ifndef FLASH_LOG_SPI_SPEED
+#define FLASH_LOG_SPI_SPEED 10000000
+#endif
+
+/// <summary>Largest number of sectors used, bounds the RAM index (4 bytes per sector).</summary>
+#ifndef FLASH_LOG_MAX_SECTORS
+#define FLASH_LOG_MAX_SECTORS 512
+#endif
+
+#define FLASH_LOG_SECTOR_SIZE 4096
+#define FLASH_LOG_PAGE_SIZE   256
+
+/// <summary>One logged sample as stored in the flash, 16 bytes.</summary>
+typedef struct __attribute__((__packed__)) {
+	/// <summary>Seconds of logged operation, see above.</summary>
+	uint32_t time;
+	/// <summary>Raw pressure, 4096 LSB/hPa.</summary>
+	uint32_t pressure;
+	/// <summary>Temperature [0.01 *C].</summary>
+	int16_t  temperature;
+	/// <summary>Raw 12-bit ambient light ADC code.</summary>
+	uint16_t light;
+	uint16_t reserved;
+	/// <summary>CRC-16/CCITT-FALSE of the preceding bytes.</summary>
+	uint16_t crc;
+} FlashLog_Record;
+
+typedef struct {
+	/// <summary>Flash size used [bytes], 0 if no flash was found.</summary>
+	uint32_t size;
+	uint32_t sectors;
+	/// <summary>Sectors holding records.</summary>
+	uint32_t sectorsUsed;
+	/// <summary>Times of the oldest and the newest record, valid if sectorsUsed > 0.</summary>
+	uint32_t firstTime;
+	uint32_t lastTime;
+	/// <summary>Records appended since boot.</summary>
+	uint32_t appended;
+	/// <summary>Records dropped because the flash was still busy with both page buffers.</summary>
+	uint32_t overruns;
+	/// <summary>Failed SPI transfers, the page being written is dropped.</summary>
+	uint32_t errors;
+} FlashLog_Status;
+
+/// <summary>Position of a range read.</summary>
+typedef struct {
+	/// <summary>Sector, counted from the oldest one.</summary>
+	uint32_t sector;
+	/// <summary>Record within the sector.</summary>
+	uint32_t slot;
+	/// <summary>Last time of the range [s].</summary>
+	uint32_t to;
+	/// <summary>Records read ahead from the flash.</summary>
+	FlashLog_Record cache[FLASH_LOG_PAGE_SIZE / sizeof(FlashLog_Record)];
+	uint32_t        cacheSector;
+	uint32_t        cacheSlot;
+	uint32_t        cacheCount;
+} FlashLog_Cursor;
+
+/// <summary>
+/// <para>Opens the SPI unit, identifies the flash and mounts the log.</para>
+/// </summary>
+/// <param name="unit">ISU the flash is connected to.</param>
+/// <returns>ERROR_NONE on success, ERROR_UNSUPPORTED if no flash answers, or the SPI
+/// error.</returns>
+int32_t FlashLog_Init(Platform_Unit unit);
+
+/// <summary>
+/// <para>Queues a sample. Returns at once; the page is written once full.</para>
+/// </summary>
+/// <returns>false if the log isn't mounted or both page buffers are busy.</returns>
+bool FlashLog_Append(const SampleLog_Sample* sample);
+
+/// <summary>
+/// <para>Queues the partly filled page for writing, so the records appended so far survive a
+/// reset. The rest of the page is programmed when it fills up.</para>
+/// </summary>
+void FlashLog_Sync(void);
+
+/// <summary>
+/// <para>Advances a pending flash operation. Call from the main loop; the status of an erase or
+/// program is polled every millisecond or two, not on every call.</para>
+/// </summary>
+void FlashLog_Poll(void);
+
+/// <summary>Returns the time until FlashLog_Poll() has work to do [ms], 0 if it has some now and
+/// UINT32_MAX if none is pending; for Scheduler_SetIdleLimit().</summary>
+uint32_t FlashLog_IdleLimit(void);
+
+/// <summary>Fills in the state of the log.</summary>
+void FlashLog_GetStatus(FlashLog_Status* status);
+
+/// <summary>
+/// <para>Starts a range read at the first record at or after from. Waits for pending writes,
+/// records which are still buffered in RAM aren't returned.</para>
+/// </summary>
+/// <param name="cursor">Cursor to set up.</param>
+/// <param name="from">First time of the range [s].</param>
+/// <param name="to">Last time of the range [s].</param>
+/// <returns>false if the log holds no records.</returns>
+bool FlashLog_Find(FlashLog_Cursor* cursor, uint32_t from, uint32_t to);
+
+/// <summary>
+/// <para>Reads the next record of a range. Records with a bad CRC are skipped.</para>
+/// </summary>
+/// <returns>false at the end of the range.</returns>
+bool FlashLog_Next(FlashLog_Cursor* cursor, FlashLog_Record* record);
+
+#endif // #ifndef FLASH_LOG_H_
@@ -0,0 +1,123 @@
+#include "governor.h"
+#include "../lib/CPUFreq.h"
+
+static const uint32_t governorFreq[GOVERNOR_LEVEL_COUNT] = {
+	[GOVERNOR_LEVEL_LOW ] = GOVERNOR_FREQ_LOW,
+	[GOVERNOR_LEVEL_HIGH] = GOVERNOR_FREQ_HIGH,
+};
+
+static GPT*           governorClock = NULL;
+static uint32_t       governorRate = 0;
+static uint32_t       governorLast = 0;
+static uint64_t       governorCounts[GOVERNOR_LEVEL_COUNT] = { 0 };
+static uint32_t       governorTransitions = 0;
+static uint32_t       governorBoosts = 0;
+static Governor_Level governorLevel = GOVERNOR_LEVEL_LOW;
+static Governor_Mode  governorMode = GOVERNOR_MODE_AUTO;
+
+// Charges the time since the last call to the current level.
+static void Governor_Account(void)
+{
+	uint32_t count = GPT_GetCount(governorClock);
+	governorCounts[governorLevel] += (uint32_t)(count - governorLast);
+	governorLast = count;
+}
+
+static void Governor_Apply(void)
+{
+	if (!governorClock) {
+		return;
+	}
+
+	Governor_Level level;
+	switch (governorMode) {
+	case GOVERNOR_MODE_LOW:
+		level = GOVERNOR_LEVEL_LOW;
+		break;
+	case GOVERNOR_MODE_HIGH:
+		level = GOVERNOR_LEVEL_HIGH;
+		break;
+	default:
+		level = (governorBoosts > 0) ? GOVERNOR_LEVEL_HIGH : GOVERNOR_LEVEL_LOW;
+		break;
+	}
+	if (level == governorLevel) {
+		return;
+	}
+
+	Governor_Account();
+	if (CPUFreq_Set(governorFreq[level])) {
+		governorLevel = level;
+		governorTransitions++;
+	}
+}
+
+int32_t Governor_Init(GPT* clock)
+{
+	float speed;
+	if (!clock || (GPT_GetSpeed(clock, &speed) != ERROR_NONE) || (speed < 1000.0f)) {
+		return ERROR_PARAMETER;
+	}
+	if (!CPUFreq_Set(governorFreq[GOVERNOR_LEVEL_LOW])) {
+		return ERROR_UNSUPPORTED;
+	}
+
+	governorClock = clock;
+	governorRate  = (uint32_t)(speed + 0.5f);
+	// GPT_Start_Freerun() cleared the count, which can't be read back for a few cycles.
+	governorLast  = 0;
+	governorLevel = GOVERNOR_LEVEL_LOW;
+	Governor_Apply();
+	return ERROR_NONE;
+}
+
+void Governor_Boost(void)
+{
+	if (governorBoosts++ == 0) {
+		Governor_Apply();
+	}
+}
+
+void Governor_Release(void)
+{
+	if ((governorBoosts > 0) && (--governorBoosts == 0)) {
+		Governor_Apply();
+	}
+}
+
+void Governor_SetMode(Governor_Mode mode)
+{
+	governorMode = mode;
+	Governor_Apply();
+}
+
+Governor_Mode Governor_GetMode(void)
+{
+	return governorMode;
+}
+
+uint32_t Governor_Frequency(Governor_Level level)
+{
+	return (level < GOVERNOR_LEVEL_COUNT) ? governorFreq[level] : 0;
+}
+
+void Governor_Update(void)
+{
+	if (governorClock) {
+		Governor_Account();
+	}
+}
+
+uint32_t Governor_Residency(Governor_Level level)
+{
+	if (!governorClock || (level >= GOVERNOR_LEVEL_COUNT)) {
+		return 0;
+	}
+	Governor_Account();
+	return (uint32_t)((governorCounts[level] * 1000) / governorRate);
+}
+
+uint32_t Governor_Transitions(void)
+{
+	return governorTransitions;
+}
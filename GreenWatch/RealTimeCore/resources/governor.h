@@ -0,0 +1,70 @@
+#ifndef GOVERNOR_H_
+#define GOVERNOR_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../lib/GPT.h"
+
+// Clock governor of the M4 core.
+//
+// The core runs from the 26 MHz crystal and switches to the 197.6 MHz PLL while burst work
+// holds a boost: deferred interrupt callbacks (ADC FIFO drains, command handling, exports),
+// rendering the UI screens and the tasks marked boost in the scheduler. Everything else,
+// waiting on the I2C sensors and idling in wfi, runs at 26 MHz.
+//
+// Nothing has to be re-derived on a change: the ISU (UART, I2C, SPI), ADC and GPT0 to GPT3
+// clocks come from the crystal or the 32 kHz oscillator whatever the core clock, and GPT4,
+// the only timer on the bus clock, reads its speed through CPUFreq_Get().
+
+#define GOVERNOR_FREQ_LOW  26000000
+#define GOVERNOR_FREQ_HIGH 197600000
+
+typedef enum {
+	GOVERNOR_LEVEL_LOW,
+	GOVERNOR_LEVEL_HIGH,
+	GOVERNOR_LEVEL_COUNT
+} Governor_Level;
+
+typedef enum {
+	/// <summary>High while a boost is held, low otherwise.</summary>
+	GOVERNOR_MODE_AUTO,
+	GOVERNOR_MODE_LOW,
+	GOVERNOR_MODE_HIGH,
+} Governor_Mode;
+
+/// <summary>
+/// <para>Switches the core to the low clock and starts counting residency.</para>
+/// </summary>
+/// <param name="clock">Free-running timer to measure residency with, just started, see
+/// Scheduler_Init().</param>
+/// <returns>ERROR_NONE on success, ERROR_PARAMETER for a missing timer or
+/// ERROR_UNSUPPORTED if the clock can't be set.</returns>
+int32_t Governor_Init(GPT* clock);
+
+/// <summary>Raises the core clock until the matching Governor_Release(), boosts nest. Only
+/// call from the main loop.</summary>
+void Governor_Boost(void);
+
+/// <summary>Releases a boost taken by Governor_Boost().</summary>
+void Governor_Release(void);
+
+/// <summary>Overrides the governor, for measurements.</summary>
+void Governor_SetMode(Governor_Mode mode);
+
+Governor_Mode Governor_GetMode(void);
+
+/// <summary>Returns the core clock of a level [Hz].</summary>
+uint32_t Governor_Frequency(Governor_Level level);
+
+/// <summary>Charges the time since the last change or update to the current level. Call more
+/// often than the clock wraps; Scheduler_Idle() does on every wait.</summary>
+void Governor_Update(void);
+
+/// <summary>Returns the time spent at a level since Governor_Init() [ms].</summary>
+uint32_t Governor_Residency(Governor_Level level);
+
+/// <summary>Returns the number of clock changes since Governor_Init().</summary>
+uint32_t Governor_Transitions(void);
+
+#endif // #ifndef GOVERNOR_H_
@@ -0,0 +1,111 @@
+#include <string.h>
+#include "light.h"
+
+// Nominal response: lux = V / (0.1 uA/lx * 3.65 kOhm) with V = code * 2.5 V / ADC_MAX_VAL.
+#define LIGHT_DEFAULT_LUX(i) \
+	((uint32_t)((((uint64_t)(i) << LIGHT_LUT_SHIFT) * 2500000ULL) / ((uint64_t)ADC_MAX_VAL * 365ULL)))
+
+#define LIGHT_DEFAULT_4(i) \
+	LIGHT_DEFAULT_LUX(i), LIGHT_DEFAULT_LUX((i) + 1), LIGHT_DEFAULT_LUX((i) + 2), LIGHT_DEFAULT_LUX((i) + 3)
+#define LIGHT_DEFAULT_16(i) \
+	LIGHT_DEFAULT_4(i), LIGHT_DEFAULT_4((i) + 4), LIGHT_DEFAULT_4((i) + 8), LIGHT_DEFAULT_4((i) + 12)
+#define LIGHT_DEFAULT_TABLE \
+	LIGHT_DEFAULT_16(0), LIGHT_DEFAULT_16(16), LIGHT_DEFAULT_16(32), LIGHT_DEFAULT_16(48), LIGHT_DEFAULT_LUX(64)
+
+_Static_assert(LIGHT_LUT_SIZE == 65, "LIGHT_DEFAULT_TABLE must cover the code space");
+
+static XIP_RODATA const uint32_t lightDefault[LIGHT_LUT_SIZE] = { LIGHT_DEFAULT_TABLE };
+static uint32_t lightLut[LIGHT_LUT_SIZE] = { LIGHT_DEFAULT_TABLE };
+static bool lightCalibrated = false;
+
+// Reference points, ascending by code.
+static Light_CalPoint lightPoints[LIGHT_CAL_POINTS];
+static uint32_t lightPointCount = 0;
+
+uint32_t Light_ToLux(uint16_t code)
+{
+	if (code > ADC_MAX_VAL) {
+		code = ADC_MAX_VAL;
+	}
+
+	uint32_t i = code >> LIGHT_LUT_SHIFT;
+	int32_t  f = code & (LIGHT_LUT_STEP - 1);
+	int32_t  a = (int32_t)lightLut[i];
+	int32_t  b = (int32_t)lightLut[i + 1];
+	return (uint32_t)(a + (((b - a) * f) / LIGHT_LUT_STEP));
+}
+
+bool Light_CalAdd(uint16_t code, uint32_t lux)
+{
+	uint32_t i;
+	for (i = 0; (i < lightPointCount) && (lightPoints[i].code < code); i++);
+
+	if ((i < lightPointCount) && (lightPoints[i].code == code)) {
+		lightPoints[i].lux = lux;
+		return true;
+	}
+	if (lightPointCount >= LIGHT_CAL_POINTS) {
+		return false;
+	}
+
+	memmove(&lightPoints[i + 1], &lightPoints[i], (lightPointCount - i) * sizeof(lightPoints[0]));
+	lightPoints[i] = (Light_CalPoint){ .code = code, .lux = lux };
+	lightPointCount++;
+	return true;
+}
+
+void Light_CalClear(void)
+{
+	lightPointCount = 0;
+}
+
+uint32_t Light_CalCount(void)
+{
+	return lightPointCount;
+}
+
+const Light_CalPoint* Light_CalGet(uint32_t index)
+{
+	return (index < lightPointCount) ? &lightPoints[index] : NULL;
+}
+
+bool Light_CalApply(void)
+{
+	if ((lightPointCount == 0) || ((lightPointCount == 1) && (lightPoints[0].code == 0))) {
+		return false;
+	}
+
+	uint32_t i, segment = 0;
+	for (i = 0; i < LIGHT_LUT_SIZE; i++) {
+		int64_t code = (int64_t)i << LIGHT_LUT_SHIFT;
+		int64_t lux;
+		if (lightPointCount == 1) {
+			lux = (code * lightPoints[0].lux) / lightPoints[0].code;
+		}
+		else {
+			// Segment between points segment and segment + 1, the outer ones are extended.
+			while (((segment + 2) < lightPointCount) && (code > lightPoints[segment + 1].code)) {
+				segment++;
+			}
+			const Light_CalPoint* p0 = &lightPoints[segment];
+			const Light_CalPoint* p1 = &lightPoints[segment + 1];
+			lux = (int64_t)p0->lux
+				+ (((code - p0->code) * ((int64_t)p1->lux - (int64_t)p0->lux)) / (p1->code - p0->code));
+		}
+		lightLut[i] = (lux < 0) ? 0 : ((lux > LIGHT_LUX_MAX) ? LIGHT_LUX_MAX : (uint32_t)lux);
+	}
+	lightCalibrated = true;
+	return true;
+}
+
+void Light_CalReset(void)
+{
+	memcpy(lightLut, lightDefault, sizeof(lightLut));
+	lightCalibrated = false;
+	lightPointCount = 0;
+}
+
+bool Light_IsCalibrated(void)
+{
+	return lightCalibrated;
+}
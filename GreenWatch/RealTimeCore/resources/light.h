@@ -0,0 +1,84 @@
+#ifndef LIGHT_H_
+#define LIGHT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "utilities.h"
+
+// Conversion of the 12-bit ambient light ADC code to illuminance and photosynthetic photon
+// flux density.
+//
+// The sensor response is a piecewise linear table over the code space with an entry every
+// LIGHT_LUT_STEP codes, so a conversion is a shift, a lookup and an integer multiply-add. The
+// default table is generated at compile time from the nominal response of the ALS-PT19
+// phototransistor on the starter kit: 0.1 uA/lx into 3.65 kOhm, read against 2.5 V.
+//
+// Calibration replaces the table: reference readings are captured as (code, lux) pairs with
+// Light_CalAdd() and Light_CalApply() rebuilds the table through them. The table lives in RAM,
+// so a reset returns to the default.
+
+#define LIGHT_LUT_SHIFT 6
+#define LIGHT_LUT_STEP  (1 << LIGHT_LUT_SHIFT)
+
+/// <summary>Table entries, one past the last code so every code has a next entry.</summary>
+#define LIGHT_LUT_SIZE  (((ADC_MAX_VAL + 1) >> LIGHT_LUT_SHIFT) + 1)
+
+/// <summary>Largest illuminance in the table [lx], keeps the interpolation within 32 bits.</summary>
+#define LIGHT_LUX_MAX 1000000
+
+/// <summary>Reference points kept for a calibration.</summary>
+#define LIGHT_CAL_POINTS 8
+
+/// <summary>Illuminance per unit of PPFD [lx per umol/m2/s]; 54 for daylight, white LED
+/// grow lights are nearer 70 to 80.</summary>
+#ifndef LIGHT_LUX_PER_PPFD
+#define LIGHT_LUX_PER_PPFD 54
+#endif
+
+typedef struct {
+	uint16_t code;
+	uint32_t lux;
+} Light_CalPoint;
+
+/// <summary>Returns the illuminance for an ADC code [lx].</summary>
+uint32_t Light_ToLux(uint16_t code);
+
+/// <summary>Returns the photosynthetic photon flux density for an illuminance, rounded
+/// [umol/m2/s].</summary>
+static inline uint32_t Light_LuxToPpfd(uint32_t lux)
+{
+	return (lux + (LIGHT_LUX_PER_PPFD / 2)) / LIGHT_LUX_PER_PPFD;
+}
+
+/// <summary>
+/// <para>Adds a reference point, replacing one with the same code.</para>
+/// </summary>
+/// <param name="code">ADC code read at the reference illuminance.</param>
+/// <param name="lux">Reference illuminance [lx], e.g. from a lux meter.</param>
+/// <returns>false if LIGHT_CAL_POINTS points are held already.</returns>
+bool Light_CalAdd(uint16_t code, uint32_t lux);
+
+/// <summary>Drops the reference points, the table is kept.</summary>
+void Light_CalClear(void);
+
+/// <summary>Returns the number of reference points.</summary>
+uint32_t Light_CalCount(void);
+
+/// <summary>Returns a reference point, in ascending code order, or NULL.</summary>
+const Light_CalPoint* Light_CalGet(uint32_t index);
+
+/// <summary>
+/// <para>Rebuilds the table from the reference points: one point scales the response through
+/// the origin, more points are joined by straight lines, extended beyond the outer points and
+/// clipped to 0 to LIGHT_LUX_MAX.</para>
+/// </summary>
+/// <returns>false if there are no points or one point at code 0, the table is kept.</returns>
+bool Light_CalApply(void);
+
+/// <summary>Returns to the default table and drops the reference points.</summary>
+void Light_CalReset(void);
+
+/// <summary>Returns true if the table was built from reference points.</summary>
+bool Light_IsCalibrated(void);
+
+#endif // #ifndef LIGHT_H_
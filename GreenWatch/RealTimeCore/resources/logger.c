@@ -0,0 +1,162 @@
+#include "logger.h"
+#include "../lib/NVIC.h"
+
+#if (LOGGER_RING_WORDS & (LOGGER_RING_WORDS - 1)) != 0
+#error "Logger ring size must be a power of two"
+#endif
+
+#define LOGGER_RING_MASK (LOGGER_RING_WORDS - 1)
+
+// Header word layout: token in bits 31..16, argument count in bits 7..0.
+#define LOGGER_HEADER(token, count) (((uint32_t)(token) << 16) | ((count) & 0xFF))
+#define LOGGER_HEADER_TOKEN(header) ((uint16_t)((header) >> 16))
+#define LOGGER_HEADER_COUNT(header) ((header) & 0xFF)
+
+// Frame layout: start byte, argument count, token (LE), arguments (LE).
+#define LOGGER_FRAME_SIZE(count) (4 + ((count) * 4))
+
+static UART* logUart = NULL;
+
+uint8_t Logger_ModuleLevel[LOG_MODULE_COUNT] = {
+	[LOG_MODULE_SYSTEM ] = LOG_LEVEL_INFO,
+	[LOG_MODULE_LSM6DSO] = LOG_LEVEL_DEBUG,
+	[LOG_MODULE_LPS22HH] = LOG_LEVEL_DEBUG,
+	[LOG_MODULE_LIGHT  ] = LOG_LEVEL_DEBUG,
+	[LOG_MODULE_UI     ] = LOG_LEVEL_INFO,
+};
+
+static const char* const logModuleNames[LOG_MODULE_COUNT] = {
+	[LOG_MODULE_SYSTEM ] = "System",
+	[LOG_MODULE_LSM6DSO] = "LSM6DSO",
+	[LOG_MODULE_LPS22HH] = "LPS22HH",
+	[LOG_MODULE_LIGHT  ] = "Light",
+	[LOG_MODULE_UI     ] = "UI",
+};
+
+static const char* const logLevelNames[LOG_LEVEL_NONE + 1] = {
+	[LOG_LEVEL_DEBUG] = "DEBUG",
+	[LOG_LEVEL_INFO ] = "INFO",
+	[LOG_LEVEL_WARN ] = "WARN",
+	[LOG_LEVEL_ERROR] = "ERROR",
+	[LOG_LEVEL_NONE ] = "OFF",
+};
+
+static __attribute__((section(".sysram"))) uint32_t logRing[LOGGER_RING_WORDS];
+static volatile uint32_t logHead = 0;
+static volatile uint32_t logTail = 0;
+static volatile uint32_t logDropped = 0;
+
+void Logger_Init(UART* handle)
+{
+	logUart = handle;
+}
+
+UART* Logger_Uart(void)
+{
+	return logUart;
+}
+
+bool Logger_SetLevel(Logger_Module module, uint8_t level)
+{
+	if ((module >= LOG_MODULE_COUNT) || (level > LOG_LEVEL_NONE)) {
+		return false;
+	}
+	Logger_ModuleLevel[module] = level;
+	return true;
+}
+
+uint8_t Logger_GetLevel(Logger_Module module)
+{
+	return (module < LOG_MODULE_COUNT) ? Logger_ModuleLevel[module] : LOG_LEVEL_NONE;
+}
+
+const char* Logger_ModuleName(Logger_Module module)
+{
+	return (module < LOG_MODULE_COUNT) ? logModuleNames[module] : "?";
+}
+
+const char* Logger_LevelName(uint8_t level)
+{
+	return (level <= LOG_LEVEL_NONE) ? logLevelNames[level] : "?";
+}
+
+bool Logger_Write(uint16_t token, const uint32_t* args, uint32_t count)
+{
+	if (count > LOGGER_MAX_ARGS) {
+		count = LOGGER_MAX_ARGS;
+	}
+
+	uint32_t prevBasePri = NVIC_BlockIRQs();
+	if ((LOGGER_RING_WORDS - (logHead - logTail)) < (count + 1)) {
+		logDropped++;
+		NVIC_RestoreIRQs(prevBasePri);
+		return false;
+	}
+
+	uint32_t head = logHead;
+	logRing[head++ & LOGGER_RING_MASK] = LOGGER_HEADER(token, count);
+	uint32_t i;
+	for (i = 0; i < count; i++) {
+		logRing[head++ & LOGGER_RING_MASK] = args[i];
+	}
+	logHead = head;
+	NVIC_RestoreIRQs(prevBasePri);
+
+	return true;
+}
+
+static uint32_t Logger_EncodeFrame(uint8_t* frame, uint16_t token, const uint32_t* args, uint32_t count)
+{
+	frame[0] = LOGGER_FRAME_START;
+	frame[1] = (uint8_t)count;
+	frame[2] = (uint8_t)(token & 0xFF);
+	frame[3] = (uint8_t)(token >> 8);
+
+	uint32_t i;
+	for (i = 0; i < count; i++) {
+		frame[4 + (i * 4) + 0] = (uint8_t)(args[i]);
+		frame[4 + (i * 4) + 1] = (uint8_t)(args[i] >> 8);
+		frame[4 + (i * 4) + 2] = (uint8_t)(args[i] >> 16);
+		frame[4 + (i * 4) + 3] = (uint8_t)(args[i] >> 24);
+	}
+
+	return LOGGER_FRAME_SIZE(count);
+}
+
+void Logger_Flush(void)
+{
+	if (!logUart) {
+		return;
+	}
+
+	uint8_t frame[LOGGER_FRAME_SIZE(LOGGER_MAX_ARGS)];
+
+	// Report dropped entries first so the host knows there's a gap.
+	uint32_t dropped = logDropped;
+	if ((dropped > 0) && (UART_WriteAvailable(logUart) >= LOGGER_FRAME_SIZE(1))) {
+		UART_Write(logUart, frame, Logger_EncodeFrame(frame, LOGGER_TOKEN_DROPPED, &dropped, 1));
+		uint32_t prevBasePri = NVIC_BlockIRQs();
+		logDropped -= dropped;
+		NVIC_RestoreIRQs(prevBasePri);
+	}
+
+	// Only the main loop consumes, so the tail doesn't need IRQs blocked.
+	while (logTail != logHead) {
+		uint32_t tail = logTail;
+		uint32_t header = logRing[tail++ & LOGGER_RING_MASK];
+		uint32_t count = LOGGER_HEADER_COUNT(header);
+
+		if (UART_WriteAvailable(logUart) < LOGGER_FRAME_SIZE(count)) {
+			break;
+		}
+
+		uint32_t args[LOGGER_MAX_ARGS];
+		uint32_t i;
+		for (i = 0; i < count; i++) {
+			args[i] = logRing[tail++ & LOGGER_RING_MASK];
+		}
+		logTail = tail;
+
+		UART_Write(logUart, frame, Logger_EncodeFrame(frame, LOGGER_HEADER_TOKEN(header), args, count));
+	}
+}
@@ -0,0 +1,176 @@
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../lib/UART.h"
+#include "../lib/Print.h"
+
+// When LOG_DEFERRED is defined, LOG() calls don't format anything on the device. The format
+// string is placed in the non-loaded .log_fmt section and its offset in that section is used
+// as a token. The token and the raw 32-bit arguments are stored in a RAM ring and drained to
+// the debug UART as binary frames by Logger_Flush(). tools/logdecode.py restores the text
+// using the .log_fmt section extracted from the ELF file.
+//
+// Without LOG_DEFERRED, LOG() is a plain UART_Printf() to the debug UART.
+//
+// Arguments must be integers (at most 32 bits) or floats wrapped in LOG_F32(). Strings (%s)
+// can't be deferred.
+//
+// LOG_DEBUG() .. LOG_ERROR() add a severity and a module. Calls below LOG_MIN_LEVEL compile to
+// nothing, the rest are filtered at runtime against the per-module level.
+
+/// <summary>Log severities, in increasing order.</summary>
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE  4
+
+/// <summary>Least severe level compiled in, normally set from CMakeLists.txt.</summary>
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+/// <summary>Modules with their own runtime log level.</summary>
+typedef enum {
+	LOG_MODULE_SYSTEM,
+	LOG_MODULE_LSM6DSO,
+	LOG_MODULE_LPS22HH,
+	LOG_MODULE_LIGHT,
+	LOG_MODULE_UI,
+	LOG_MODULE_COUNT
+} Logger_Module;
+
+/// <summary>Size of the deferred log ring in 32-bit words, must be a power of two.</summary>
+#define LOGGER_RING_WORDS 512
+
+/// <summary>Maximum number of arguments a single deferred log entry can carry.</summary>
+#define LOGGER_MAX_ARGS 8
+
+/// <summary>First byte of every binary frame sent by <see cref="Logger_Flush" />.</summary>
+#define LOGGER_FRAME_START 0xFE
+
+/// <summary>Token of the frame reporting entries dropped because the ring was full.</summary>
+#define LOGGER_TOKEN_DROPPED 0xFFFF
+
+/// <summary>
+/// <para>Sets the UART that log output goes to.</para>
+/// </summary>
+/// <param name="handle">Debug UART handle, may be NULL to discard output.</param>
+void Logger_Init(UART* handle);
+
+/// <summary>
+/// <para>Returns the UART set by <see cref="Logger_Init" />.</para>
+/// </summary>
+UART* Logger_Uart(void);
+
+/// <summary>
+/// <para>Sets the runtime level of a module; messages less severe than it are discarded.</para>
+/// </summary>
+/// <param name="module">Module to configure.</param>
+/// <param name="level">LOG_LEVEL_DEBUG to LOG_LEVEL_NONE.</param>
+/// <returns>false if the module or level is invalid.</returns>
+bool Logger_SetLevel(Logger_Module module, uint8_t level);
+
+/// <summary>Returns the runtime level of a module.</summary>
+uint8_t Logger_GetLevel(Logger_Module module);
+
+/// <summary>Returns a printable module name.</summary>
+const char* Logger_ModuleName(Logger_Module module);
+
+/// <summary>Returns a printable level name.</summary>
+const char* Logger_LevelName(uint8_t level);
+
+/// <summary>Runtime level per module, use <see cref="Logger_SetLevel" /> to change it.</summary>
+extern uint8_t Logger_ModuleLevel[LOG_MODULE_COUNT];
+
+/// <summary>Returns true when a message of the given level passes the module filter.</summary>
+static inline bool Logger_Enabled(Logger_Module module, uint8_t level)
+{
+#if LOG_MIN_LEVEL > 0
+	if (level < LOG_MIN_LEVEL) {
+		return false;
+	}
+#endif
+	return (level >= Logger_ModuleLevel[module]);
+}
+
+/// <summary>
+/// <para>Stores a token and its arguments in the log ring. Safe to call from interrupts.</para>
+/// </summary>
+/// <param name="token">Offset of the format string in the .log_fmt section.</param>
+/// <param name="args">Raw argument words.</param>
+/// <param name="count">Number of argument words, at most LOGGER_MAX_ARGS.</param>
+/// <returns>false if the entry was dropped.</returns>
+bool Logger_Write(uint16_t token, const uint32_t* args, uint32_t count);
+
+/// <summary>
+/// <para>Drains as many queued entries as currently fit in the UART TX buffer without
+/// blocking. Call it from the main loop when idle.</para>
+/// </summary>
+void Logger_Flush(void);
+
+/// <summary>Reinterprets a float as a raw argument word.</summary>
+static inline uint32_t Logger_FloatBits(float value)
+{
+	union {
+		float    f;
+		uint32_t u;
+	} bits = { .f = value };
+	return bits.u;
+}
+
+#ifdef LOG_DEFERRED
+
+#define LOG_F32(x) Logger_FloatBits((float)(x))
+
+#define LOG(fmt, ...) do { \
+		static const char logFmt[] __attribute__((section(".log_fmt"))) = fmt; \
+		const uint32_t logArgs[] = { 0, ##__VA_ARGS__ }; \
+		Logger_Write((uint16_t)(uintptr_t)logFmt, &logArgs[1], \
+			(sizeof(logArgs) / sizeof(logArgs[0])) - 1); \
+	} while (0)
+
+#else // #ifdef LOG_DEFERRED
+
+#define LOG_F32(x) ((double)(x))
+
+#define LOG(fmt, ...) UART_Printf(Logger_Uart(), fmt, ##__VA_ARGS__)
+
+#endif // #ifdef LOG_DEFERRED
+
+#define LOG_AT(level, module, fmt, ...) do { \
+		if (Logger_Enabled(module, level)) { \
+			LOG(fmt, ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LOG_DISCARD(module, fmt, ...) do { } while (0)
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(module, fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, module, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG LOG_DISCARD
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(module, fmt, ...) LOG_AT(LOG_LEVEL_INFO, module, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO LOG_DISCARD
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(module, fmt, ...) LOG_AT(LOG_LEVEL_WARN, module, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN LOG_DISCARD
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(module, fmt, ...) LOG_AT(LOG_LEVEL_ERROR, module, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR LOG_DISCARD
+#endif
+
+#endif // #ifndef LOGGER_H_
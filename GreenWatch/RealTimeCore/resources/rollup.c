@@ -0,0 +1,171 @@
+#include "rollup.h"
+
+typedef struct {
+	uint32_t period;
+	uint32_t length;
+	uint32_t offset;
+} Rollup_Tier;
+
+static const Rollup_Tier rollupTiers[ROLLUP_TIER_COUNT] = {
+	{ .period =   60, .length = 60, .offset =   0 },
+	{ .period =  900, .length = 96, .offset =  60 },
+	{ .period = 3600, .length = 48, .offset = 156 },
+};
+
+_Static_assert((156 + 48) == ROLLUP_BUCKET_COUNT, "Rollup tiers don't match ROLLUP_BUCKET_COUNT");
+
+static void Rollup_Feed(Rollup_Store* store, uint32_t tier, uint32_t time, const Rollup_Bucket* in);
+
+void Rollup_Init(Rollup_Store* store)
+{
+	*store = (Rollup_Store){ 0 };
+}
+
+static void Rollup_Merge(Rollup_Accumulator* acc, const Rollup_Bucket* in)
+{
+	if (in->count == 0) {
+		return;
+	}
+	if ((acc->count == 0) || (in->min < acc->min)) {
+		acc->min = in->min;
+	}
+	if ((acc->count == 0) || (in->max > acc->max)) {
+		acc->max = in->max;
+	}
+	acc->sum += (int64_t)in->mean * in->count;
+	acc->count += in->count;
+}
+
+static void Rollup_Close(Rollup_Store* store, uint32_t tier)
+{
+	const Rollup_Tier* t = &rollupTiers[tier];
+	Rollup_Accumulator* acc = &store->open[tier];
+
+	Rollup_Bucket bucket = { 0 };
+	if (acc->count > 0) {
+		int64_t half = (acc->sum < 0 ? -(int64_t)(acc->count / 2) : (int64_t)(acc->count / 2));
+		bucket.min   = acc->min;
+		bucket.max   = acc->max;
+		bucket.mean  = (int32_t)((acc->sum + half) / (int64_t)acc->count);
+		bucket.count = acc->count;
+	}
+
+	store->buckets[t->offset + (store->closed[tier] % t->length)] = bucket;
+	store->closed[tier]++;
+
+	uint32_t start = acc->start;
+	acc->sum   = 0;
+	acc->count = 0;
+	acc->start = start + t->period;
+
+	if ((tier + 1) < ROLLUP_TIER_COUNT) {
+		Rollup_Feed(store, tier + 1, start, &bucket);
+	}
+}
+
+static void Rollup_Feed(Rollup_Store* store, uint32_t tier, uint32_t time, const Rollup_Bucket* in)
+{
+	const Rollup_Tier* t = &rollupTiers[tier];
+	Rollup_Accumulator* acc = &store->open[tier];
+	uint32_t start = time - (time % t->period);
+
+	if (!acc->started) {
+		acc->start   = start;
+		acc->started = true;
+	}
+
+	if (start > acc->start) {
+		// Close the open bucket and any empty periods up to this one. After a whole ring of
+		// empty buckets the rest can be skipped.
+		uint32_t gap = (start - acc->start) / t->period;
+		if (gap > t->length) {
+			uint32_t skip = gap - t->length;
+			store->closed[tier] += skip;
+			acc->start += skip * t->period;
+			gap = t->length;
+		}
+		while (gap-- > 0) {
+			Rollup_Close(store, tier);
+		}
+	}
+
+	Rollup_Merge(acc, in);
+}
+
+void Rollup_Add(Rollup_Store* store, uint32_t time, int32_t value)
+{
+	Rollup_Bucket sample = { .min = value, .max = value, .mean = value, .count = 1 };
+	Rollup_Feed(store, 0, time, &sample);
+}
+
+uint32_t Rollup_TierPeriod(uint32_t tier)
+{
+	return (tier < ROLLUP_TIER_COUNT) ? rollupTiers[tier].period : 0;
+}
+
+uint32_t Rollup_TierLength(uint32_t tier)
+{
+	return (tier < ROLLUP_TIER_COUNT) ? rollupTiers[tier].length : 0;
+}
+
+bool Rollup_Get(const Rollup_Store* store, uint32_t tier, uint32_t age, Rollup_Bucket* bucket, uint32_t* start)
+{
+	if (tier >= ROLLUP_TIER_COUNT) {
+		return false;
+	}
+
+	const Rollup_Tier* t = &rollupTiers[tier];
+	uint32_t closed = store->closed[tier];
+	if ((age >= t->length) || (age >= closed)) {
+		return false;
+	}
+
+	*bucket = store->buckets[t->offset + ((closed - 1 - age) % t->length)];
+	if (start) {
+		*start = store->open[tier].start - ((age + 1) * t->period);
+	}
+	return true;
+}
+
+bool Rollup_Summary(const Rollup_Store* store, uint32_t window, Rollup_Bucket* summary)
+{
+	uint32_t tier;
+	for (tier = 0; tier < ROLLUP_TIER_COUNT; tier++) {
+		if (window <= (rollupTiers[tier].period * rollupTiers[tier].length)) {
+			break;
+		}
+	}
+	if (tier >= ROLLUP_TIER_COUNT) {
+		return false;
+	}
+
+	// The open bucket of the finest tier holds the newest samples, and every finer tier's open
+	// bucket holds samples not yet merged into this tier.
+	Rollup_Accumulator acc = { 0 };
+	uint32_t i;
+	for (i = 0; i <= tier; i++) {
+		const Rollup_Accumulator* open = &store->open[i];
+		if (open->count > 0) {
+			Rollup_Bucket partial = {
+				.min = open->min, .max = open->max,
+				.mean = (int32_t)(open->sum / (int64_t)open->count), .count = open->count };
+			Rollup_Merge(&acc, &partial);
+		}
+	}
+
+	uint32_t period = rollupTiers[tier].period;
+	uint32_t buckets = (window + period - 1) / period;
+	Rollup_Bucket bucket;
+	for (i = 0; (i < buckets) && Rollup_Get(store, tier, i, &bucket, NULL); i++) {
+		Rollup_Merge(&acc, &bucket);
+	}
+
+	if (acc.count == 0) {
+		return false;
+	}
+	summary->min   = acc.min;
+	summary->max   = acc.max;
+	summary->mean  = (int32_t)(acc.sum / (int64_t)acc.count);
+	summary->count = acc.count;
+	return true;
+}
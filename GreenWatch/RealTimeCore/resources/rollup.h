@@ -0,0 +1,83 @@
+#ifndef ROLLUP_H_
+#define ROLLUP_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Multi-resolution history of one channel. Every sample goes into the open 1 minute bucket;
+// when a bucket closes it's stored in its tier's ring and merged into the open bucket of the
+// next coarser tier, so each write costs O(1) regardless of history length.
+//
+// Tier 0 keeps 1 minute buckets for 1 hour, tier 1 15 minute buckets for 24 hours and tier 2
+// 1 hour buckets for 48 hours. Periods without samples are stored as empty buckets, so the
+// start time of every bucket follows from its position.
+
+#define ROLLUP_TIER_COUNT 3
+
+// Total number of buckets over all tiers, see rollupTiers in rollup.c.
+#define ROLLUP_BUCKET_COUNT (60 + 96 + 48)
+
+typedef struct {
+	int32_t  min;
+	int32_t  max;
+	int32_t  mean;
+	uint32_t count;
+} Rollup_Bucket;
+
+typedef struct {
+	int64_t  sum;
+	int32_t  min;
+	int32_t  max;
+	uint32_t count;
+	/// <summary>Start of the open bucket [s].</summary>
+	uint32_t start;
+	bool     started;
+} Rollup_Accumulator;
+
+typedef struct {
+	Rollup_Bucket      buckets[ROLLUP_BUCKET_COUNT];
+	Rollup_Accumulator open[ROLLUP_TIER_COUNT];
+	/// <summary>Number of buckets closed per tier, free-running.</summary>
+	uint32_t           closed[ROLLUP_TIER_COUNT];
+} Rollup_Store;
+
+/// <summary>Clears a store.</summary>
+void Rollup_Init(Rollup_Store* store);
+
+/// <summary>
+/// <para>Adds a sample. Times must not go backwards.</para>
+/// </summary>
+/// <param name="store">Store to update.</param>
+/// <param name="time">Sample time [s].</param>
+/// <param name="value">Sample value, in the channel's raw unit.</param>
+void Rollup_Add(Rollup_Store* store, uint32_t time, int32_t value);
+
+/// <summary>Returns the bucket period of a tier [s], or 0 for an invalid tier.</summary>
+uint32_t Rollup_TierPeriod(uint32_t tier);
+
+/// <summary>Returns the number of buckets kept by a tier, or 0 for an invalid tier.</summary>
+uint32_t Rollup_TierLength(uint32_t tier);
+
+/// <summary>
+/// <para>Reads a closed bucket.</para>
+/// </summary>
+/// <param name="store">Store to read.</param>
+/// <param name="tier">Tier to read.</param>
+/// <param name="age">0 for the most recently closed bucket.</param>
+/// <param name="bucket">Receives the bucket, count is 0 for a period without samples.</param>
+/// <param name="start">Receives the start time of the bucket [s], may be NULL.</param>
+/// <returns>false if the bucket doesn't exist (yet).</returns>
+bool Rollup_Get(const Rollup_Store* store, uint32_t tier, uint32_t age, Rollup_Bucket* bucket, uint32_t* start);
+
+/// <summary>
+/// <para>Summarises the latest window seconds, using the finest tier which covers them. The
+/// open buckets are included, so the result is as fresh as the last sample.</para>
+/// </summary>
+/// <param name="store">Store to read.</param>
+/// <param name="window">Length of the window [s].</param>
+/// <param name="summary">Receives min, max, mean and count over the window.</param>
+/// <returns>false if the window is longer than the store keeps or holds no samples.</returns>
+bool Rollup_Summary(const Rollup_Store* store, uint32_t window, Rollup_Bucket* summary);
+
+#endif // #ifndef ROLLUP_H_
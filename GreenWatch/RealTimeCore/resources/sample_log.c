@@ -0,0 +1,163 @@
+#include "sample_log.h"
+
+// Largest encoded sample: one 5 byte varint for the timestamp and for every channel.
+#define SAMPLE_LOG_MAX_ENCODED ((1 + SAMPLE_LOG_CHANNELS) * 5)
+
+_Static_assert((SAMPLE_LOG_BLOCK_COUNT & (SAMPLE_LOG_BLOCK_COUNT - 1)) == 0,
+	"SAMPLE_LOG_BLOCK_COUNT must be a power of two");
+
+static inline uint32_t SampleLog_ZigZag(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t SampleLog_UnZigZag(uint32_t value)
+{
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint32_t SampleLog_PutVarint(uint8_t* dst, int32_t value)
+{
+	uint32_t raw = SampleLog_ZigZag(value);
+	uint32_t size = 0;
+	while (raw >= 0x80) {
+		dst[size++] = (uint8_t)(raw | 0x80);
+		raw >>= 7;
+	}
+	dst[size++] = (uint8_t)raw;
+	return size;
+}
+
+static bool SampleLog_GetVarint(SampleLog_Reader* reader, int32_t* value)
+{
+	uint32_t raw = 0;
+	uint32_t shift;
+	for (shift = 0; shift < 35; shift += 7) {
+		if (reader->pos >= reader->block->used) {
+			return false;
+		}
+		uint8_t byte = reader->block->data[reader->pos++];
+		raw |= (uint32_t)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) {
+			*value = SampleLog_UnZigZag(raw);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Differences are taken modulo 2^32, so any timestamp or value round-trips exactly.
+static uint32_t SampleLog_Encode(SampleLog_State* state, const SampleLog_Sample* sample, uint8_t* dst)
+{
+	uint32_t interval = sample->timestamp - state->timestamp;
+	uint32_t size = SampleLog_PutVarint(dst, (int32_t)(interval - state->interval));
+	state->timestamp = sample->timestamp;
+	state->interval  = interval;
+
+	uint32_t i;
+	for (i = 0; i < SAMPLE_LOG_CHANNELS; i++) {
+		size += SampleLog_PutVarint(&dst[size], (int32_t)((uint32_t)sample->value[i] - (uint32_t)state->value[i]));
+		state->value[i] = sample->value[i];
+	}
+	return size;
+}
+
+void SampleLog_Init(SampleLog_Store* store)
+{
+	store->state = (SampleLog_State){ 0 };
+	store->first = 0;
+	store->last  = 0;
+	store->blocks[0].used  = 0;
+	store->blocks[0].count = 0;
+}
+
+void SampleLog_Append(SampleLog_Store* store, const SampleLog_Sample* sample)
+{
+	uint8_t encoded[SAMPLE_LOG_MAX_ENCODED];
+	SampleLog_State state = store->state;
+	uint32_t size = SampleLog_Encode(&state, sample, encoded);
+
+	SampleLog_Block* block = &store->blocks[store->last & (SAMPLE_LOG_BLOCK_COUNT - 1)];
+	if ((block->used + size) > SAMPLE_LOG_BLOCK_SIZE) {
+		store->last++;
+		if ((store->last - store->first) >= SAMPLE_LOG_BLOCK_COUNT) {
+			store->first++;
+		}
+		block = &store->blocks[store->last & (SAMPLE_LOG_BLOCK_COUNT - 1)];
+		block->used  = 0;
+		block->count = 0;
+
+		state = (SampleLog_State){ 0 };
+		size = SampleLog_Encode(&state, sample, encoded);
+	}
+
+	uint32_t i;
+	for (i = 0; i < size; i++) {
+		block->data[block->used + i] = encoded[i];
+	}
+	block->used += size;
+	block->count++;
+	store->state = state;
+}
+
+uint32_t SampleLog_BlockCount(const SampleLog_Store* store)
+{
+	if (store->blocks[store->last & (SAMPLE_LOG_BLOCK_COUNT - 1)].count == 0) {
+		return store->last - store->first;
+	}
+	return store->last - store->first + 1;
+}
+
+uint32_t SampleLog_SampleCount(const SampleLog_Store* store)
+{
+	uint32_t count = 0;
+	uint32_t i;
+	for (i = store->first; i != (store->last + 1); i++) {
+		count += store->blocks[i & (SAMPLE_LOG_BLOCK_COUNT - 1)].count;
+	}
+	return count;
+}
+
+const SampleLog_Block* SampleLog_GetBlock(const SampleLog_Store* store, uint32_t index)
+{
+	if (index >= SampleLog_BlockCount(store)) {
+		return NULL;
+	}
+	return &store->blocks[(store->first + index) & (SAMPLE_LOG_BLOCK_COUNT - 1)];
+}
+
+void SampleLog_ReaderInit(SampleLog_Reader* reader, const SampleLog_Block* block)
+{
+	reader->block = block;
+	reader->pos   = 0;
+	reader->index = 0;
+	reader->state = (SampleLog_State){ 0 };
+}
+
+bool SampleLog_Next(SampleLog_Reader* reader, SampleLog_Sample* sample)
+{
+	if (!reader->block || (reader->index >= reader->block->count)) {
+		return false;
+	}
+
+	SampleLog_State* state = &reader->state;
+	int32_t delta;
+	if (!SampleLog_GetVarint(reader, &delta)) {
+		return false;
+	}
+	state->interval  += (uint32_t)delta;
+	state->timestamp += state->interval;
+	sample->timestamp = state->timestamp;
+
+	uint32_t i;
+	for (i = 0; i < SAMPLE_LOG_CHANNELS; i++) {
+		if (!SampleLog_GetVarint(reader, &delta)) {
+			return false;
+		}
+		state->value[i] = (int32_t)((uint32_t)state->value[i] + (uint32_t)delta);
+		sample->value[i] = state->value[i];
+	}
+
+	reader->index++;
+	return true;
+}
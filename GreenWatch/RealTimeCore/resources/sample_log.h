@@ -0,0 +1,94 @@
+#ifndef SAMPLE_LOG_H_
+#define SAMPLE_LOG_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "channels.h"
+
+// Compressed history of the logged samples.
+//
+// Samples are encoded into fixed size blocks as zig-zag varints: the timestamp as the change
+// of the previous sample interval (delta-of-delta, 0 for a steady interval) and every channel
+// as the change from the previous sample. A steady interval costs one byte and slowly changing
+// channels one or two bytes each, against 12 bytes for the plain values.
+//
+// Every block restarts from a zero state, so it decodes on its own and can be exported as is.
+// When the store is full the oldest block is dropped.
+
+#define SAMPLE_LOG_CHANNELS CHANNEL_COUNT
+
+/// <summary>Bytes of encoded data per block.</summary>
+#define SAMPLE_LOG_BLOCK_SIZE 240
+
+/// <summary>Number of blocks kept, must be a power of two.</summary>
+#define SAMPLE_LOG_BLOCK_COUNT 16
+
+typedef struct {
+	/// <summary>Time since boot [ms].</summary>
+	uint32_t timestamp;
+	/// <summary>Channel values in their raw units, indexed by Channel_Id.</summary>
+	int32_t  value[SAMPLE_LOG_CHANNELS];
+} SampleLog_Sample;
+
+/// <summary>Last decoded or encoded sample, the reference for the next one.</summary>
+typedef struct {
+	uint32_t timestamp;
+	uint32_t interval;
+	int32_t  value[SAMPLE_LOG_CHANNELS];
+} SampleLog_State;
+
+typedef struct {
+	uint8_t  data[SAMPLE_LOG_BLOCK_SIZE];
+	/// <summary>Number of bytes used in data.</summary>
+	uint16_t used;
+	/// <summary>Number of samples in the block.</summary>
+	uint16_t count;
+} SampleLog_Block;
+
+typedef struct {
+	SampleLog_Block blocks[SAMPLE_LOG_BLOCK_COUNT];
+	/// <summary>Encoder state of the newest block.</summary>
+	SampleLog_State state;
+	/// <summary>Free-running indices of the oldest and the newest block.</summary>
+	uint32_t        first;
+	uint32_t        last;
+} SampleLog_Store;
+
+/// <summary>Streaming decoder of one block.</summary>
+typedef struct {
+	const SampleLog_Block* block;
+	uint16_t               pos;
+	uint16_t               index;
+	SampleLog_State        state;
+} SampleLog_Reader;
+
+/// <summary>Clears a store.</summary>
+void SampleLog_Init(SampleLog_Store* store);
+
+/// <summary>
+/// <para>Encodes a sample into the newest block, starting a new block when it doesn't fit.</para>
+/// </summary>
+void SampleLog_Append(SampleLog_Store* store, const SampleLog_Sample* sample);
+
+/// <summary>Returns the number of blocks in the store, the newest one may still be growing.</summary>
+uint32_t SampleLog_BlockCount(const SampleLog_Store* store);
+
+/// <summary>Returns the number of samples in the store.</summary>
+uint32_t SampleLog_SampleCount(const SampleLog_Store* store);
+
+/// <summary>
+/// <para>Returns a block, 0 for the oldest one, or NULL if it doesn't exist.</para>
+/// </summary>
+const SampleLog_Block* SampleLog_GetBlock(const SampleLog_Store* store, uint32_t index);
+
+/// <summary>Starts decoding a block from its first sample.</summary>
+void SampleLog_ReaderInit(SampleLog_Reader* reader, const SampleLog_Block* block);
+
+/// <summary>
+/// <para>Decodes the next sample of a block.</para>
+/// </summary>
+/// <returns>false at the end of the block or if the block is corrupt.</returns>
+bool SampleLog_Next(SampleLog_Reader* reader, SampleLog_Sample* sample);
+
+#endif // #ifndef SAMPLE_LOG_H_
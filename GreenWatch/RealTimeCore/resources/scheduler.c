@@ -0,0 +1,239 @@
+#include "scheduler.h"
+#include "governor.h"
+#include "../lib/NVIC.h"
+
+volatile uint32_t uptimeMs = 0;
+
+static GPT*     clockTimer = NULL;
+static GPT*     wakeupTimer = NULL;
+static uint32_t clockRate = 0;
+static uint32_t clockLast = 0;
+// Clock counts since Scheduler_Init(), extended to 64 bits.
+static uint64_t clockCounts = 0;
+
+static uint32_t idleSleeps = 0;
+static uint32_t idleMs = 0;
+
+static CallbackNode* volatile callbacks = NULL;
+static uint32_t (*idleLimit)(void) = NULL;
+
+// Tasks ascending by priority, tasks of equal priority in the order they were added.
+static Scheduler_Task* tasks = NULL;
+
+// Times wrap after 49 days, so they are only ever compared through their difference.
+static inline bool Scheduler_Reached(uint32_t now, uint32_t time)
+{
+	return ((int32_t)(now - time) >= 0);
+}
+
+// Reads the clock, the caller must read it more often than it wraps.
+static uint32_t Scheduler_Now(void)
+{
+	if (!clockTimer) {
+		return uptimeMs;
+	}
+	uint32_t count = GPT_GetCount(clockTimer);
+	clockCounts += (uint32_t)(count - clockLast);
+	clockLast = count;
+	uptimeMs = (uint32_t)((clockCounts * 1000) / clockRate);
+	return uptimeMs;
+}
+
+int32_t Scheduler_Init(GPT* clock, GPT* wakeup)
+{
+	float speed;
+	if (!clock || !wakeup || (GPT_GetSpeed(clock, &speed) != ERROR_NONE) || (speed < 1000.0f)) {
+		return ERROR_PARAMETER;
+	}
+
+	clockTimer  = clock;
+	wakeupTimer = wakeup;
+	clockRate   = (uint32_t)(speed + 0.5f);
+	// GPT_Start_Freerun() has just cleared the count, which can't be read back for a few
+	// cycles of the 32 kHz clock.
+	clockLast   = 0;
+	clockCounts = ((uint64_t)uptimeMs * clockRate) / 1000;
+	return ERROR_NONE;
+}
+
+void Scheduler_SetIdleLimit(uint32_t (*limit)(void))
+{
+	idleLimit = limit;
+}
+
+void Scheduler_Enqueue(CallbackNode* node)
+{
+	uint32_t prevBasePri = NVIC_BlockIRQs();
+	if (!node->enqueued) {
+		CallbackNode* prevHead = callbacks;
+		node->enqueued = true;
+		callbacks = node;
+		node->next = prevHead;
+	}
+	NVIC_RestoreIRQs(prevBasePri);
+}
+
+static void Scheduler_InvokeCallbacks(void)
+{
+	CallbackNode* node;
+	bool boosted = false;
+	do {
+		uint32_t prevBasePri = NVIC_BlockIRQs();
+		node = callbacks;
+		if (node) {
+			node->enqueued = false;
+			callbacks = node->next;
+		}
+		NVIC_RestoreIRQs(prevBasePri);
+
+		if (node) {
+			if (!boosted) {
+				Governor_Boost();
+				boosted = true;
+			}
+			(*node->cb)();
+		}
+	} while (node);
+
+	if (boosted) {
+		Governor_Release();
+	}
+}
+
+void Scheduler_Add(Scheduler_Task* task)
+{
+	task->release = uptimeMs + task->phase;
+	task->runs    = 0;
+	task->misses  = 0;
+	task->worst   = 0;
+
+	Scheduler_Task** link = &tasks;
+	while (*link && ((*link)->priority <= task->priority)) {
+		link = &(*link)->next;
+	}
+	task->next = *link;
+	*link = task;
+}
+
+static Scheduler_Task* Scheduler_NextDue(uint32_t now)
+{
+	Scheduler_Task* task;
+	for (task = tasks; task; task = task->next) {
+		if (Scheduler_Reached(now, task->release)) {
+			return task;
+		}
+	}
+	return NULL;
+}
+
+void Scheduler_Run(void)
+{
+	Scheduler_Now();
+	Scheduler_InvokeCallbacks();
+
+	Scheduler_Task* task;
+	while ((task = Scheduler_NextDue(Scheduler_Now())) != NULL) {
+		if (task->boost) {
+			Governor_Boost();
+		}
+		task->run();
+		if (task->boost) {
+			Governor_Release();
+		}
+		task->runs++;
+
+		uint32_t now = Scheduler_Now();
+		uint32_t late = now - task->release;
+		if (late > task->worst) {
+			task->worst = late;
+		}
+		if (late > task->deadline) {
+			task->misses++;
+		}
+
+		// Releases whose deadline has passed already are skipped.
+		task->release += task->period;
+		while ((task->period > 0) && !Scheduler_Reached(task->release + task->deadline, now)) {
+			task->release += task->period;
+			task->misses++;
+		}
+
+		Scheduler_InvokeCallbacks();
+	}
+}
+
+static void Scheduler_Wakeup(GPT* timer)
+{
+	// Taking the interrupt is all it takes to end the wfi.
+}
+
+void Scheduler_Idle(void)
+{
+	// With PRIMASK set, an interrupt raised from here on stays pending and still ends the wfi,
+	// so work queued after the check below can't wait for the next release.
+	__asm__ volatile ("cpsid i" ::: "memory");
+
+	if (!callbacks) {
+		uint32_t now = Scheduler_Now();
+		uint32_t wait = SCHEDULER_MAX_IDLE_MS;
+		if (idleLimit) {
+			uint32_t limit = idleLimit();
+			if (limit < wait) {
+				wait = limit;
+			}
+		}
+		const Scheduler_Task* task;
+		for (task = tasks; task; task = task->next) {
+			if (Scheduler_Reached(now, task->release)) {
+				wait = 0;
+				break;
+			}
+			if ((task->release - now) < wait) {
+				wait = task->release - now;
+			}
+		}
+
+		// Wake on the clock count which starts the release ms, the count after if it falls
+		// between two.
+		if (wait > 0) {
+			uint32_t elapsedUs = (uint32_t)(((clockCounts * 1000000) / clockRate) % 1000);
+			uint32_t waitUs = (wait * 1000) - elapsedUs + ((1000000 + clockRate - 1) / clockRate);
+
+			GPT_Stop(wakeupTimer);
+			if (GPT_StartTimeout(wakeupTimer, waitUs, GPT_UNITS_MICROSEC, &Scheduler_Wakeup) == ERROR_NONE) {
+				__asm__ volatile ("wfi" ::: "memory");
+				idleSleeps++;
+				idleMs += Scheduler_Now() - now;
+			}
+		}
+	}
+
+	// Waits are capped well within a wrap of the clock, so the governor never misses one.
+	Governor_Update();
+	__asm__ volatile ("cpsie i" ::: "memory");
+}
+
+void Scheduler_GetIdle(uint32_t* sleeps, uint32_t* sleepMs)
+{
+	*sleeps  = idleSleeps;
+	*sleepMs = idleMs;
+}
+
+const Scheduler_Task* Scheduler_TaskAt(uint32_t index)
+{
+	const Scheduler_Task* task = tasks;
+	while (task && (index-- > 0)) {
+		task = task->next;
+	}
+	return task;
+}
+
+void Scheduler_ResetStats(void)
+{
+	Scheduler_Task* task;
+	for (task = tasks; task; task = task->next) {
+		task->runs   = 0;
+		task->misses = 0;
+		task->worst  = 0;
+	}
+}
@@ -0,0 +1,109 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../lib/GPT.h"
+
+// Run-to-completion scheduler of the main loop.
+//
+// Interrupt handlers defer their work by queueing a CallbackNode; periodic work is a
+// Scheduler_Task released every period ms from its phase. Scheduler_Run() first runs the
+// queued callbacks, then the due tasks one at a time in priority order, running the callbacks
+// queued meanwhile between tasks, so deferred interrupt work waits for one task at most.
+// Callbacks run with a governor boost, see governor.h.
+//
+// A task which finishes later than its deadline after its release counts a miss; releases
+// which pass while a task is still waiting are skipped and count a miss each.
+//
+// There is no periodic tick. Time is read from a free-running timer and Scheduler_Idle()
+// programs a one-shot timer for the next release before waiting for an interrupt, so the core
+// only wakes when a task is due or an interrupt has work for it.
+
+/// <summary>Longest wait in Scheduler_Idle() [ms], well within the 36 hours it takes the
+/// free-running timer to wrap at 32 kHz.</summary>
+#define SCHEDULER_MAX_IDLE_MS 60000
+
+/// <summary>Time since boot [ms], as read by the latest Scheduler_Run() or Scheduler_Idle();
+/// callbacks and tasks see the time they were started at.</summary>
+extern volatile uint32_t uptimeMs;
+
+typedef struct CallbackNode {
+	bool enqueued;
+	struct CallbackNode* next;
+	void (*cb)(void);
+} CallbackNode;
+
+typedef struct Scheduler_Task {
+	const char* name;
+	void        (*run)(void);
+	/// <summary>Time between releases [ms], not 0. It may be changed at any time and applies
+	/// from the next release.</summary>
+	uint32_t    period;
+	/// <summary>Time from Scheduler_Add() to the first release [ms].</summary>
+	uint32_t    phase;
+	/// <summary>Time from a release by which the task must have finished [ms].</summary>
+	uint32_t    deadline;
+	/// <summary>0 runs first among tasks due at the same time.</summary>
+	uint8_t     priority;
+	/// <summary>Runs at the high core clock, for compute bound tasks; see governor.h.</summary>
+	bool        boost;
+
+	uint32_t    release;
+	uint32_t    runs;
+	uint32_t    misses;
+	/// <summary>Latest finish after a release seen [ms].</summary>
+	uint32_t    worst;
+	struct Scheduler_Task* next;
+} Scheduler_Task;
+
+/// <summary>
+/// <para>Queues a callback to run from the main loop, a callback already queued isn't queued
+/// again. Safe to call from interrupt handlers.</para>
+/// </summary>
+void Scheduler_Enqueue(CallbackNode* node);
+
+/// <summary>
+/// <para>Sets a bound on the wait for work left to the main loop without queueing a callback,
+/// by an interrupt handler or for a time not on a task release. Scheduler_Idle() calls it with
+/// the interrupts masked and waits at most the time it returns [ms], 0 returns at once.</para>
+/// </summary>
+void Scheduler_SetIdleLimit(uint32_t (*limit)(void));
+
+/// <summary>
+/// <para>Adds a task, its first release is phase ms from now. A task must be added once.</para>
+/// </summary>
+void Scheduler_Add(Scheduler_Task* task);
+
+/// <summary>
+/// <para>Sets the timers of the scheduler, before any task is added.</para>
+/// </summary>
+/// <param name="clock">Timer just started with GPT_Start_Freerun(), at least 1 kHz, counting
+/// up.</param>
+/// <param name="wakeup">One-shot interrupt timer of the same or a finer resolution, used by
+/// Scheduler_Idle() only.</param>
+/// <returns>ERROR_NONE on success or ERROR_PARAMETER for a missing or unusable timer.</returns>
+int32_t Scheduler_Init(GPT* clock, GPT* wakeup);
+
+/// <summary>Runs the queued callbacks and the due tasks, returns when none is left.</summary>
+void Scheduler_Run(void);
+
+/// <summary>
+/// <para>Waits for an interrupt, with the wakeup timer set for the next release unless that
+/// is due already. Returns at once if a callback is queued or the pending check is true. Call
+/// from the main loop when everything else is done.</para>
+/// </summary>
+void Scheduler_Idle(void);
+
+/// <summary>Returns the number of waits in Scheduler_Idle() and the time spent in them [ms]
+/// since boot.</summary>
+void Scheduler_GetIdle(uint32_t* sleeps, uint32_t* sleepMs);
+
+/// <summary>Returns a task in priority order, or NULL past the last one.</summary>
+const Scheduler_Task* Scheduler_TaskAt(uint32_t index);
+
+/// <summary>Clears the run and miss counts of every task.</summary>
+void Scheduler_ResetStats(void);
+
+#endif // #ifndef SCHEDULER_H_
@@ -0,0 +1,118 @@
+#include "stats.h"
+
+static const uint32_t statsEwmaPeriod[STATS_EWMA_COUNT] = { 60, 900, 3600 };
+
+void Stats_Init(Stats_Channel* stats)
+{
+	*stats = (Stats_Channel){ 0 };
+}
+
+// Returns 1 - exp(-x) for x >= 0 without libm. The exponent is halved until a Taylor series
+// of exp(-x) - 1 converges, then squared back as (1 + m)^2 - 1 = m * (2 + m), which keeps the
+// precision of small results.
+static float_t Stats_Alpha(float_t x)
+{
+	if (x >= 16.0f) {
+		return 1.0f;
+	}
+
+	uint32_t halvings = 0;
+	while (x > 0.0625f) {
+		x *= 0.5f;
+		halvings++;
+	}
+	float_t m = -x * (1.0f - (x / 2.0f) * (1.0f - (x / 3.0f) * (1.0f - (x / 4.0f))));
+	while (halvings-- > 0) {
+		m *= 2.0f + m;
+	}
+	return -m;
+}
+
+void Stats_Add(Stats_Channel* stats, uint32_t time, int32_t value)
+{
+	uint32_t i;
+
+	if (stats->count == 0) {
+		stats->reference = value;
+		stats->min       = value;
+		stats->max       = value;
+		stats->minTime   = time;
+		stats->maxTime   = time;
+	}
+	else if (value < stats->min) {
+		stats->min     = value;
+		stats->minTime = time;
+	}
+	else if (value > stats->max) {
+		stats->max     = value;
+		stats->maxTime = time;
+	}
+
+	float_t x = (float_t)(value - stats->reference);
+	stats->count++;
+	float_t delta = x - stats->mean;
+	stats->mean += delta / (float_t)stats->count;
+	stats->m2   += delta * (x - stats->mean);
+
+	if (stats->count == 1) {
+		for (i = 0; i < STATS_EWMA_COUNT; i++) {
+			stats->ewma[i] = x;
+		}
+	}
+	else {
+		// Exact discretisation of the RC filter: alpha = 1 - exp(-dt / tau).
+		float_t dt = (float_t)(time - stats->lastTime) / 1000.0f;
+		for (i = 0; i < STATS_EWMA_COUNT; i++) {
+			float_t alpha = Stats_Alpha(dt / (float_t)statsEwmaPeriod[i]);
+			stats->ewma[i] += alpha * (x - stats->ewma[i]);
+		}
+	}
+	stats->lastTime = time;
+}
+
+float_t Stats_Mean(const Stats_Channel* stats)
+{
+	if (stats->count == 0) {
+		return 0.0f;
+	}
+	return (float_t)stats->reference + stats->mean;
+}
+
+// Newton's method, so the image doesn't need libm for the one square root.
+static float_t Stats_Sqrt(float_t x)
+{
+	if (x <= 0.0f) {
+		return 0.0f;
+	}
+	float_t r = (x > 1.0f ? x : 1.0f);
+	uint32_t i;
+	for (i = 0; i < 64; i++) {
+		float_t next = 0.5f * (r + (x / r));
+		if (next >= r) {
+			break;
+		}
+		r = next;
+	}
+	return r;
+}
+
+float_t Stats_StdDev(const Stats_Channel* stats)
+{
+	if (stats->count < 2) {
+		return 0.0f;
+	}
+	return Stats_Sqrt(stats->m2 / (float_t)(stats->count - 1));
+}
+
+uint32_t Stats_EwmaPeriod(uint32_t index)
+{
+	return (index < STATS_EWMA_COUNT ? statsEwmaPeriod[index] : 0);
+}
+
+float_t Stats_Ewma(const Stats_Channel* stats, uint32_t index)
+{
+	if ((stats->count == 0) || (index >= STATS_EWMA_COUNT)) {
+		return 0.0f;
+	}
+	return (float_t)stats->reference + stats->ewma[index];
+}
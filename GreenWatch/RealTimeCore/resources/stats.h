@@ -0,0 +1,57 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+// Running statistics of one channel, updated in O(1) per sample so summaries never scan the
+// logs.
+//
+// Mean and variance use Welford's algorithm on the difference to the first sample. Channels
+// like the raw pressure (about 2^22) would lose their low bits in a float otherwise, while the
+// differences stay small. The EWMAs are first order low-pass filters with the time constants
+// below, discretised exactly (alpha = 1 - exp(-dt / tau)) for any sample interval.
+
+#define STATS_EWMA_COUNT 3
+
+typedef struct {
+	uint32_t count;
+	/// <summary>First sample, mean, m2 and ewma are relative to it.</summary>
+	int32_t  reference;
+	float_t  mean;
+	/// <summary>Sum of squared differences from the mean.</summary>
+	float_t  m2;
+	int32_t  min;
+	int32_t  max;
+	/// <summary>Times of the minimum and the maximum [ms].</summary>
+	uint32_t minTime;
+	uint32_t maxTime;
+	uint32_t lastTime;
+	float_t  ewma[STATS_EWMA_COUNT];
+} Stats_Channel;
+
+/// <summary>Clears the statistics of a channel.</summary>
+void Stats_Init(Stats_Channel* stats);
+
+/// <summary>
+/// <para>Adds a sample.</para>
+/// </summary>
+/// <param name="stats">Channel to update.</param>
+/// <param name="time">Sample time [ms].</param>
+/// <param name="value">Sample value, in the channel's raw unit.</param>
+void Stats_Add(Stats_Channel* stats, uint32_t time, int32_t value);
+
+/// <summary>Returns the mean in the channel's raw unit, 0 without samples.</summary>
+float_t Stats_Mean(const Stats_Channel* stats);
+
+/// <summary>Returns the sample standard deviation in the channel's raw unit.</summary>
+float_t Stats_StdDev(const Stats_Channel* stats);
+
+/// <summary>Returns the time constant of an EWMA [s], or 0 for an invalid index.</summary>
+uint32_t Stats_EwmaPeriod(uint32_t index);
+
+/// <summary>Returns an EWMA in the channel's raw unit, 0 without samples.</summary>
+float_t Stats_Ewma(const Stats_Channel* stats, uint32_t index);
+
+#endif // #ifndef STATS_H_
@@ -0,0 +1,77 @@
+#include "telemetry.h"
+
+static uint8_t telemetrySequence = 0;
+static uint32_t telemetryDropped = 0;
+
+uint16_t Telemetry_Crc16(const uint8_t* data, uint32_t size)
+{
+	uint16_t crc = 0xFFFF;
+	uint32_t i;
+	for (i = 0; i < size; i++) {
+		crc ^= (uint16_t)data[i] << 8;
+		uint8_t bit;
+		for (bit = 0; bit < 8; bit++) {
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		}
+	}
+	return crc;
+}
+
+uint32_t Telemetry_CobsEncode(const uint8_t* src, uint32_t size, uint8_t* dst)
+{
+	uint32_t out = 1;
+	uint32_t code = 0;
+	uint8_t run = 1;
+
+	uint32_t i;
+	for (i = 0; i < size; i++) {
+		if (src[i] != 0) {
+			dst[out++] = src[i];
+			run++;
+		}
+		if ((src[i] == 0) || (run == 0xFF)) {
+			dst[code] = run;
+			code = out++;
+			run = 1;
+		}
+	}
+	dst[code] = run;
+
+	return out;
+}
+
+bool Telemetry_Send(UART* handle, void* record, uint32_t size)
+{
+	if (!handle || !record || (size == 0) || (size > TELEMETRY_MAX_RECORD)) {
+		return false;
+	}
+
+	uint8_t raw[TELEMETRY_MAX_RECORD + 2];
+	uint8_t frame[TELEMETRY_MAX_FRAME];
+
+	// Every frame uses up a sequence number, sent or not, so the host sees drops as gaps.
+	((uint8_t*)record)[1] = telemetrySequence++;
+
+	uint32_t i;
+	for (i = 0; i < size; i++) {
+		raw[i] = ((const uint8_t*)record)[i];
+	}
+	uint16_t crc = Telemetry_Crc16(raw, size);
+	raw[size++] = (uint8_t)(crc & 0xFF);
+	raw[size++] = (uint8_t)(crc >> 8);
+
+	uint32_t length = Telemetry_CobsEncode(raw, size, frame);
+	frame[length++] = 0x00;
+
+	if (UART_WriteAvailable(handle) < length) {
+		telemetryDropped++;
+		return false;
+	}
+
+	return (UART_Write(handle, frame, length) == ERROR_NONE);
+}
+
+uint32_t Telemetry_Dropped(void)
+{
+	return telemetryDropped;
+}
@@ -0,0 +1,99 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../lib/UART.h"
+
+// Binary telemetry frames for machine consumers of the UI UART.
+//
+// Each frame is a record followed by its CRC-16/CCITT-FALSE (little endian), COBS encoded and
+// terminated with a 0x00 delimiter, so a receiver can always resynchronise on the next zero.
+// All record fields are little endian.
+
+/// <summary>Largest record, before CRC and COBS overhead.</summary>
+#define TELEMETRY_MAX_RECORD 256
+
+/// <summary>Largest frame: record and CRC, COBS overhead and the delimiter.</summary>
+#define TELEMETRY_MAX_FRAME (TELEMETRY_MAX_RECORD + 2 + ((TELEMETRY_MAX_RECORD + 2) / 254) + 1 + 1)
+
+/// <summary>Record types, first byte of every record.</summary>
+typedef enum {
+	TELEMETRY_RECORD_SAMPLE = 1,
+	TELEMETRY_RECORD_BLOCK  = 2,
+	TELEMETRY_RECORD_DLI    = 3,
+} Telemetry_RecordType;
+
+/// <summary>One sample of all environmental channels.</summary>
+typedef struct __attribute__((__packed__)) {
+	uint8_t  type;
+	/// <summary>Incremented for every record sent, lets the host detect lost frames.</summary>
+	uint8_t  sequence;
+	/// <summary>Time since boot [ms].</summary>
+	uint32_t timestamp;
+	/// <summary>Temperature [0.01 *C].</summary>
+	int16_t  temperature;
+	/// <summary>Raw pressure, 4096 LSB/hPa.</summary>
+	uint32_t pressure;
+	/// <summary>Raw 12-bit ambient light ADC code.</summary>
+	uint16_t light;
+} Telemetry_Sample;
+
+/// <summary>
+/// <para>Compressed block of the sample history, see sample_log.h. Variable size: data holds
+/// the used bytes of the block only.</para>
+/// </summary>
+typedef struct __attribute__((__packed__)) {
+	uint8_t  type;
+	uint8_t  sequence;
+	/// <summary>Number of samples encoded in data.</summary>
+	uint16_t count;
+	uint8_t  data[];
+} Telemetry_Block;
+
+/// <summary>
+/// <para>Daily light integral of one day, see dli.h. The open day is sent once a minute with
+/// what it has accumulated so far, every day again when it closes.</para>
+/// </summary>
+typedef struct __attribute__((__packed__)) {
+	uint8_t  type;
+	uint8_t  sequence;
+	/// <summary>Number of the day, counting from 0 at boot.</summary>
+	uint16_t day;
+	/// <summary>1 if the day has closed.</summary>
+	uint8_t  closed;
+	/// <summary>Integral of the PPFD [mmol/m2].</summary>
+	uint32_t integral;
+	/// <summary>Time the light was on [min].</summary>
+	uint16_t photoperiod;
+	/// <summary>Time of day the light came on [min], 0xFFFF if it never did.</summary>
+	uint16_t onset;
+} Telemetry_Dli;
+
+/// <summary>
+/// <para>Computes CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF).</para>
+/// </summary>
+uint16_t Telemetry_Crc16(const uint8_t* data, uint32_t size);
+
+/// <summary>
+/// <para>COBS encodes a buffer. The output needs size + (size / 254) + 1 bytes and doesn't
+/// include the trailing delimiter.</para>
+/// </summary>
+/// <returns>Number of bytes written to dst.</returns>
+uint32_t Telemetry_CobsEncode(const uint8_t* src, uint32_t size, uint8_t* dst);
+
+/// <summary>
+/// <para>Frames a record and queues it on the UART. Frames which don't fit in the UART TX
+/// buffer are dropped rather than blocking the caller.</para>
+/// </summary>
+/// <param name="handle">UART to send the frame on.</param>
+/// <param name="record">Record, the first byte must be a <see cref="Telemetry_RecordType" />.
+/// The sequence byte is filled in by this function.</param>
+/// <param name="size">Record size in bytes, at most TELEMETRY_MAX_RECORD.</param>
+/// <returns>true if the frame was queued.</returns>
+bool Telemetry_Send(UART* handle, void* record, uint32_t size);
+
+/// <summary>Returns the number of frames dropped because the UART was busy.</summary>
+uint32_t Telemetry_Dropped(void);
+
+#endif // #ifndef TELEMETRY_H_
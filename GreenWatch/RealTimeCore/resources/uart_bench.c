@@ -0,0 +1,147 @@
+#include "uart_bench.h"
+#include "../lib/GPT.h"
+
+// Chunks stay well below the RX buffer, so the receive side never overflows.
+#define UARTBENCH_CHUNK      64
+#define UARTBENCH_PINGS      16
+#define UARTBENCH_TIMEOUT_US 100000
+
+#define UARTBENCH_PATTERN(position) ((uint8_t)((position) * 7))
+
+// Waits for up to size bytes, returns how many arrived before the timeout.
+static uint32_t UARTBench_Receive(UART* handle, GPT* timer, uint8_t* data, uint32_t size)
+{
+    uint32_t start = GPT_GetCount(timer);
+    uint32_t received = 0;
+    while (received < size) {
+        uintptr_t avail = UART_ReadAvailable(handle);
+        if (avail > 0) {
+            if (avail > (size - received)) {
+                avail = size - received;
+            }
+            if (UART_Read(handle, &data[received], avail) != ERROR_NONE) {
+                break;
+            }
+            received += avail;
+        } else if ((GPT_GetCount(timer) - start) > UARTBENCH_TIMEOUT_US) {
+            break;
+        }
+    }
+    return received;
+}
+
+static void UARTBench_Discard(UART* handle)
+{
+    uint8_t scratch[UARTBENCH_CHUNK];
+    uintptr_t avail;
+    while ((avail = UART_ReadAvailable(handle)) > 0) {
+        UART_Read(handle, scratch, (avail > sizeof(scratch) ? sizeof(scratch) : avail));
+    }
+}
+
+static void UARTBench_Measure(UART* handle, GPT* timer, uint32_t bytes, UARTBench_Result* result)
+{
+    uint8_t tx[UARTBENCH_CHUNK], rx[UARTBENCH_CHUNK];
+    uint32_t i;
+
+    // Throughput, two chunks are kept in flight so the line doesn't idle while the previous
+    // chunk is read back. The pattern is a function of the position, so it's checked without
+    // keeping a copy.
+    uint32_t start = GPT_GetCount(timer);
+    uint32_t sent = 0, checked = 0;
+    while (checked < bytes) {
+        while ((sent < bytes) && ((sent - checked) < (2 * UARTBENCH_CHUNK))) {
+            uint32_t chunk = bytes - sent;
+            if (chunk > UARTBENCH_CHUNK) {
+                chunk = UARTBENCH_CHUNK;
+            }
+            for (i = 0; i < chunk; i++) {
+                tx[i] = UARTBENCH_PATTERN(sent + i);
+            }
+            UART_Write(handle, tx, chunk);
+            sent += chunk;
+        }
+
+        uint32_t expect = sent - checked;
+        if (expect > UARTBENCH_CHUNK) {
+            expect = UARTBENCH_CHUNK;
+        }
+        uint32_t received = UARTBench_Receive(handle, timer, rx, expect);
+        for (i = 0; i < received; i++) {
+            if (rx[i] != UARTBENCH_PATTERN(checked + i)) {
+                result->errors++;
+            }
+        }
+        result->errors += (expect - received);
+        checked += expect;
+    }
+    result->elapsedUs = GPT_GetCount(timer) - start;
+    result->bytes = bytes;
+    result->bytesPerSec = (result->elapsedUs > 0)
+        ? (uint32_t)(((uint64_t)bytes * 1000000) / result->elapsedUs) : 0;
+
+    // Latency of single bytes.
+    uint32_t total = 0;
+    result->latencyMinUs = UINT32_MAX;
+    result->latencyMaxUs = 0;
+    for (i = 0; i < UARTBENCH_PINGS; i++) {
+        uint8_t ping = (uint8_t)(0xA5 ^ i), pong;
+        start = GPT_GetCount(timer);
+        UART_Write(handle, &ping, 1);
+        if ((UARTBench_Receive(handle, timer, &pong, 1) != 1) || (pong != ping)) {
+            result->errors++;
+        }
+        uint32_t latency = GPT_GetCount(timer) - start;
+        total += latency;
+        if (latency < result->latencyMinUs) {
+            result->latencyMinUs = latency;
+        }
+        if (latency > result->latencyMaxUs) {
+            result->latencyMaxUs = latency;
+        }
+    }
+    result->latencyAvgUs = total / UARTBENCH_PINGS;
+}
+
+int32_t UARTBench_Run(UART* handle, unsigned baud, uint32_t bytes, UARTBench_Result* result)
+{
+    if (!handle || !result || (bytes == 0)) {
+        return ERROR_PARAMETER;
+    }
+
+    unsigned restoreBaud = UART_GetBaud(handle);
+    if (restoreBaud == 0) {
+        return ERROR_HANDLE_CLOSED;
+    }
+
+    GPT* timer = GPT_Open(MT3620_UNIT_GPT3, 1000000, GPT_MODE_NONE);
+    if (!timer) {
+        return ERROR_BUSY;
+    }
+
+    *result = (UARTBench_Result){ 0 };
+
+    // Let pending output reach the host before the line goes quiet.
+    while (!UART_WriteIdle(handle)) {
+        // empty.
+    }
+
+    UART_SetLoopback(handle, true);
+    int32_t error = UART_SetBaud(handle, baud);
+    if (error == ERROR_NONE) {
+        result->baud = UART_GetBaud(handle);
+        UARTBench_Discard(handle);
+        GPT_Start_Freerun(timer);
+        UARTBench_Measure(handle, timer, bytes, result);
+
+        while (!UART_WriteIdle(handle)) {
+            // empty.
+        }
+        UART_SetBaud(handle, restoreBaud);
+    }
+    UART_SetLoopback(handle, false);
+    UARTBench_Discard(handle);
+
+    GPT_Close(timer);
+    return error;
+}
@@ -0,0 +1,37 @@
+#ifndef UART_BENCH_H_
+#define UART_BENCH_H_
+
+#include <stdint.h>
+#include "../lib/UART.h"
+
+// Loopback benchmark for the UART driver. The UART is switched to internal loopback and the
+// requested baud rate, a test pattern is sent and received back, then the original baud rate
+// is restored. The TX line stays idle for the duration of the run.
+
+/// <summary>Results of <see cref="UARTBench_Run" />.</summary>
+typedef struct {
+    /// <summary>Baud rate actually generated.</summary>
+    unsigned baud;
+    uint32_t bytes;
+    /// <summary>Bytes which came back corrupted or not at all.</summary>
+    uint32_t errors;
+    uint32_t elapsedUs;
+    uint32_t bytesPerSec;
+    /// <summary>Single byte round trip, including the RX interrupt delay [us].</summary>
+    uint32_t latencyMinUs;
+    uint32_t latencyAvgUs;
+    uint32_t latencyMaxUs;
+} UARTBench_Result;
+
+/// <summary>
+/// <para>Runs the loopback benchmark. Blocks until done, anything received by the UART meanwhile
+/// is discarded. Uses GPT3 as a microsecond time base.</para>
+/// </summary>
+/// <param name="handle">UART to benchmark, needs an RX callback so received data is buffered.</param>
+/// <param name="baud">Baud rate to run at.</param>
+/// <param name="bytes">Number of bytes to send for the throughput measurement.</param>
+/// <param name="result">Filled in with the results.</param>
+/// <returns>ERROR_NONE on success, or an error code.</returns>
+int32_t UARTBench_Run(UART* handle, unsigned baud, uint32_t bytes, UARTBench_Result* result);
+
+#endif // #ifndef UART_BENCH_H_
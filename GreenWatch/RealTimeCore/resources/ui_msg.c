@@ -1,16 +1,29 @@
 #include "ui_msg.h"
+#include "logger.h"
 
 extern uint8_t sampleInterval;
 extern uint8_t logSize;
-extern ringBuffer_int16 temperatureLog;
-extern ringBuffer_int16 pressureLog;
-extern ringBuffer_uint32 lightLog;
+extern SampleTable sampleTable;
+extern volatile uint32_t uptimeMs;
+extern Stats_Channel sampleStats[CHANNEL_COUNT];
 
 extern I2CMaster* driver;
-extern ADC_Data lightData[ADC_DATA_SIZE];
+extern const ADC_Sample* adcData;
+extern Dli_Store lightDli;
+
+// Live values are printed right after the 15 character labels.
+#define UI_VALUE_COL 16
+
+static UI_Field tempField  = { .col = UI_VALUE_COL, .unit = " [*C]" };
+static UI_Field pressField = { .col = UI_VALUE_COL, .unit = " [hPa]" };
+static UI_Field lightField = { .col = UI_VALUE_COL, .unit = " [lx]" };
+static UI_Field ppfdField  = { .col = UI_VALUE_COL, .unit = " [umol/m2/s]" };
+static UI_Field dliField   = { .col = UI_VALUE_COL, .unit = " [mol/m2]" };
+static UI_Field photoField = { .col = UI_VALUE_COL, .unit = " [h]" };
 
 void updateMenuCallback(currentMenu* handle)
 {
+    handle->Update = NULL;
     switch (handle->mainMenu)
     {
     case 0:
@@ -18,24 +31,28 @@ void updateMenuCallback(currentMenu* handle)
         break;
     case 1:
         handle->Callback = &UI_TempReportCurrent;
+        handle->Update = &UI_TempReportUpdate;
         break;
     case 2:
         handle->Callback = &UI_TempReportInterval;
         break;
     case 3:
         handle->Callback = &UI_PressureReportCurrent;
+        handle->Update = &UI_PressureReportUpdate;
         break;
     case 4:
         handle->Callback = &UI_PressureReportInterval;
         break;
     case 5:
         handle->Callback = &UI_LightReportCurrent;
+        handle->Update = &UI_LightReportUpdate;
         break;
     case 6:
         handle->Callback = &UI_LightReportInterval;
         break;
     case 7:
         handle->Callback = &UI_FullReportCurrent;
+        handle->Update = &UI_FullReportUpdate;
         break;
     case 8:
         switch (handle->subMenu)
@@ -49,6 +66,9 @@ void updateMenuCallback(currentMenu* handle)
         case 2:
             handle->Callback = &UI_SettingsLogSize;
             break;
+        case 3:
+            handle->Callback = &UI_SettingsLogLevel;
+            break;
         default:
             break;
         }
@@ -66,6 +86,94 @@ void UART_ClearTerminal(UART* handle) {
     UART_Print(handle, "[H");
 }
 
+void UI_FieldInvalidate(UI_Field* field) {
+    field->valid = false;
+}
+
+void UI_FieldUpdate(UART* handle, UI_Field* field, float_t value) {
+    // Compare at the printed precision, so noise below it doesn't cause any output.
+    int32_t shown = (int32_t)((value * 1000.0f) + ((value < 0.0f) ? -0.5f : 0.5f));
+    if (field->valid && (field->shown == shown)) {
+        return;
+    }
+    field->shown = shown;
+    field->valid = true;
+
+    // Save cursor, jump to the field, print the value over the old one, clear what's left of
+    // a longer old value and restore the cursor.
+    UART_Printf(handle, "\0337\033[%u;%uH%.3f%s\033[K\0338",
+        field->row, field->col, value, field->unit);
+}
+
+// Summary of everything logged since boot, from the running statistics.
+static void UI_StatsSummary(UART* handle, Channel_Id channel) {
+    const Stats_Channel* stats = &sampleStats[channel];
+    const char* unit = channelTable[channel].unit;
+    if (stats->count == 0) {
+        return;
+    }
+    float_t mean = Stats_Mean(stats);
+    UART_Printf(handle, "Samples:        %u\r\n", stats->count);
+    UART_Printf(handle, "Mean:           %.3f%s (sd %.3f)\r\n",
+        Channel_ToUnit(channel, mean), unit, Channel_SpreadToUnit(channel, mean, Stats_StdDev(stats)));
+    UART_Printf(handle, "Min:            %.3f%s (T-%u s)\r\n",
+        Channel_ToUnit(channel, stats->min), unit, (stats->lastTime - stats->minTime) / 1000);
+    UART_Printf(handle, "Max:            %.3f%s (T-%u s)\r\n",
+        Channel_ToUnit(channel, stats->max), unit, (stats->lastTime - stats->maxTime) / 1000);
+    UART_Printf(handle, "EWMA 1m/15m/1h: %.3f / %.3f / %.3f%s\r\n",
+        Channel_ToUnit(channel, Stats_Ewma(stats, 0)), Channel_ToUnit(channel, Stats_Ewma(stats, 1)),
+        Channel_ToUnit(channel, Stats_Ewma(stats, 2)), unit);
+    UART_Print(handle, "------------------------------------------\r\n");
+}
+
+static void UI_LogFooter(UART* handle) {
+    UART_Print(handle, "------------------------------------------\r\n");
+    UART_Print(handle, "[X] - Go back\r\n");
+    UART_Print(handle, "------------------------------------------\r\n");
+}
+
+// Prints the statistics and the latest logSize samples of a channel, oldest first.
+static void UI_ChannelLog(UART* handle, Channel_Id channel) {
+    const Channel_Descriptor* desc = &channelTable[channel];
+
+    UART_ClearTerminal(handle);
+    UART_Print(handle, "------------------------------------------\r\n");
+    UART_Printf(handle, "%s log:\r\n", desc->label);
+    UART_Print(handle, "------------------------------------------\r\n");
+    UI_StatsSummary(handle, channel);
+
+    // Raw values are at most 32 bits wide.
+    uint32_t values[SAMPLE_LOG_CAPACITY];
+    uint32_t times[SAMPLE_LOG_CAPACITY];
+    uint32_t count = SampleTable_Snapshot(&sampleTable, channel, values, times,
+        (logSize < SAMPLE_LOG_CAPACITY) ? logSize : SAMPLE_LOG_CAPACITY);
+    uint32_t i;
+    for (i = 0; i < count; i++) {
+        UART_Printf(handle, "T-%3u s:        %.3f%s\r\n", \
+            (uptimeMs - times[i]) / 1000, \
+            Channel_ToUnit(channel, Channel_RawAt(channel, values, i)), desc->unit);
+    }
+}
+
+// Prints the daily light integral of the closed days, latest first.
+static void UI_DliLog(UART* handle) {
+    Dli_Day day;
+    uint32_t age;
+    UART_Print(handle, "------------------------------------------\r\n");
+    UART_Print(handle, "Daily light integral:\r\n");
+    for (age = 0; Dli_Get(&lightDli, age, &day); age++) {
+        UART_Printf(handle, "D-%u:            %.3f [mol/m2], %.1f [h]", age + 1,
+            (float_t)day.integral / 1000.0f, (float_t)day.photoperiod / 60.0f);
+        if (day.onset != DLI_NO_ONSET) {
+            UART_Printf(handle, " from %02u:%02u", day.onset / 60, day.onset % 60);
+        }
+        UART_Print(handle, "\r\n");
+    }
+    if (age == 0) {
+        UART_Print(handle, "No full day yet\r\n");
+    }
+}
+
 void UI_DisplayMenu(UART* handle) {
     UART_ClearTerminal(handle);
     UART_Print(handle, "--------------------------------------------\r\n");
@@ -79,108 +187,125 @@ void UI_DisplayMenu(UART* handle) {
     UART_Print(handle, "[6] - Ambient Light Report - Logged data\r\n");
     UART_Print(handle, "[7] - Full Report - Current\r\n");
     UART_Print(handle, "[8] - Settings\r\n");
+    UART_Print(handle, "[9] - Binary telemetry stream ([X] to stop)\r\n");
+    UART_Print(handle, "Type help and Enter for the command interface\r\n");
     UART_Print(handle, "--------------------------------------------\r\n");
 }
 
 void UI_TempReportCurrent(UART* handle) {
-    float_t temp = 0;
-    LPS22HH_ReadTempCelsius(driver, &temp);
     UART_ClearTerminal(handle);
     UART_Print(handle, "------------------------------------------\r\n");
-    UART_Printf(handle, "Temperature:   %.3f [*C]\r\n", temp);
+    UART_Print(handle, "Temperature:\r\n");
     UART_Print(handle, "[X] - Go back\r\n");
     UART_Print(handle, "------------------------------------------\r\n");
 
+    tempField.row = 2;
+    UI_FieldInvalidate(&tempField);
+    UI_TempReportUpdate(handle);
 }
 
-void UI_TempReportInterval(UART* handle) {
-    UART_ClearTerminal(handle);
-    UART_Print(handle, "------------------------------------------\r\n");
-    UART_Print(handle, "Temperature log:\r\n");
-    UART_Print(handle, "------------------------------------------\r\n");
-    
-    uint8_t i = 0;
-    int16_t temp = 0;
-    for (i = 0; i < logSize; ++i) {
-        ringBuffer_int16_Read(&temperatureLog, &temp);
-        UART_Printf(handle, "T-%3d s:        %.3f [*C]\r\n", \
-            ((logSize * sampleInterval) - (i * sampleInterval)), \
-            (float_t)temp / 100.0f);
+void UI_TempReportUpdate(UART* handle) {
+    float_t temp = 0;
+    if (LPS22HH_ReadTempCelsius(driver, &temp)) {
+        UI_FieldUpdate(handle, &tempField, temp);
     }
-    UART_Print(handle, "------------------------------------------\r\n");
-    UART_Print(handle, "[X] - Go back\r\n");
-    UART_Print(handle, "------------------------------------------\r\n");
+}
+
+void UI_TempReportInterval(UART* handle) {
+    UI_ChannelLog(handle, CHANNEL_TEMPERATURE);
+    UI_LogFooter(handle);
 }
 
 void UI_PressureReportCurrent(UART* handle) {
-    float_t press = 0;
-    LPS22HH_ReadPressureHuman(driver, &press);
     UART_ClearTerminal(handle);
     UART_Print(handle, "------------------------------------------\r\n");
-    UART_Printf(handle, "Pressure:      %.3f [hPa]\r\n", press);
+    UART_Print(handle, "Pressure:\r\n");
     UART_Print(handle, "[X] - Go back\r\n");
     UART_Print(handle, "------------------------------------------\r\n");
-}
 
-void UI_PressureReportInterval(UART* handle) {
-    UART_ClearTerminal(handle);
-    UART_Print(handle, "------------------------------------------\r\n");
-    UART_Print(handle, "Pressure log:\r\n");
-    UART_Print(handle, "------------------------------------------\r\n");
+    pressField.row = 2;
+    UI_FieldInvalidate(&pressField);
+    UI_PressureReportUpdate(handle);
+}
 
-    uint8_t i = 0;
-    int32_t press = 0;
-    for (i = 0; i < logSize; ++i) {
-        ringBuffer_uint32_Read(&pressureLog, (uint32_t)&press);
-        UART_Printf(handle, "T-%3d s:        %.3f [hPa]\r\n", \
-            ((logSize * sampleInterval) - (i * sampleInterval)), \
-            (float_t)press / 4096.0f);
+void UI_PressureReportUpdate(UART* handle) {
+    float_t press = 0;
+    if (LPS22HH_ReadPressureHuman(driver, &press)) {
+        UI_FieldUpdate(handle, &pressField, press);
     }
-    UART_Print(handle, "------------------------------------------\r\n");
-    UART_Print(handle, "[X] - Go back\r\n");
-    UART_Print(handle, "------------------------------------------\r\n");
+}
+
+void UI_PressureReportInterval(UART* handle) {
+    UI_ChannelLog(handle, CHANNEL_PRESSURE);
+    UI_LogFooter(handle);
 }
 
 void UI_LightReportCurrent(UART* handle) {
-    float_t V = ((float_t)(lightData[0].value) * 2.5f) / ADC_MAX_VAL;
     UART_ClearTerminal(handle);
     UART_Print(handle, "------------------------------------------\r\n");
-    UART_Printf(handle, "Ambient light: %.3f [V]\r\n", V);
+    UART_Print(handle, "Ambient light:\r\n");
+    UART_Print(handle, "PPFD:\r\n");
+    UART_Print(handle, "DLI today:\r\n");
+    UART_Print(handle, "Photoperiod:\r\n");
     UART_Print(handle, "[X] - Go back\r\n");
     UART_Print(handle, "------------------------------------------\r\n");
+
+    lightField.row = 2;
+    ppfdField.row = 3;
+    dliField.row = 4;
+    photoField.row = 5;
+    UI_FieldInvalidate(&lightField);
+    UI_FieldInvalidate(&ppfdField);
+    UI_FieldInvalidate(&dliField);
+    UI_FieldInvalidate(&photoField);
+    UI_LightReportUpdate(handle);
 }
 
-void UI_LightReportInterval(UART* handle) {
-    UART_ClearTerminal(handle);
-    UART_Print(handle, "------------------------------------------\r\n");
-    UART_Print(handle, "Ambient light log:\r\n");
-    UART_Print(handle, "------------------------------------------\r\n");
+static void UI_LightFieldsUpdate(UART* handle) {
+    uint32_t lux = Light_ToLux(ADC_SAMPLE_VALUE(adcData[ADC_CHANNEL_LIGHT]));
+    UI_FieldUpdate(handle, &lightField, (float_t)lux);
+    UI_FieldUpdate(handle, &ppfdField, (float_t)Light_LuxToPpfd(lux));
+}
 
-    uint8_t i = 0;
-    uint32_t light = 0;
-    for (i = 0; i < logSize; ++i) {
-        ringBuffer_uint32_Read(&lightLog, &light);
-        UART_Printf(handle, "T-%3d s:        %.3f [V]\r\n", \
-            ((logSize * sampleInterval) - (i * sampleInterval)), \
-            ((float_t)light * 2.5f) / ADC_MAX_VAL);
-    }
-    UART_Print(handle, "------------------------------------------\r\n");
-    UART_Print(handle, "[X] - Go back\r\n");
-    UART_Print(handle, "------------------------------------------\r\n");
+void UI_LightReportUpdate(UART* handle) {
+    Dli_Day today;
+    Dli_Today(&lightDli, &today);
+    UI_LightFieldsUpdate(handle);
+    UI_FieldUpdate(handle, &dliField, (float_t)today.integral / 1000.0f);
+    UI_FieldUpdate(handle, &photoField, (float_t)today.photoperiod / 60.0f);
+}
+
+void UI_LightReportInterval(UART* handle) {
+    UI_ChannelLog(handle, CHANNEL_LIGHT);
+    UI_DliLog(handle);
+    UI_LogFooter(handle);
 }
 
 void UI_FullReportCurrent(UART* handle) {
-    float_t temp = 0, press = 0;
-    LPS22HH_ReadTempCelsius(driver, &temp);
-    LPS22HH_ReadPressureHuman(driver, &press);
-    float_t V = ((float_t)(lightData[0].value) * 2.5f) / ADC_MAX_VAL;
     UART_ClearTerminal(handle);
     UART_Print(handle, "------------------------------------------\r\n");
-    UART_Printf(handle, "Temperature:   %.3f [*C]\r\n", temp);
-    UART_Printf(handle, "Pressure:      %.3f [hPa]\r\n", press);
-    UART_Printf(handle, "Ambient light: %.3f [V]\r\n", V);
+    UART_Print(handle, "Temperature:\r\n");
+    UART_Print(handle, "Pressure:\r\n");
+    UART_Print(handle, "Ambient light:\r\n");
+    UART_Print(handle, "PPFD:\r\n");
     UART_Print(handle, "[X] - Go back\r\n");
     UART_Print(handle, "------------------------------------------\r\n");
+
+    tempField.row = 2;
+    pressField.row = 3;
+    lightField.row = 4;
+    ppfdField.row = 5;
+    UI_FieldInvalidate(&tempField);
+    UI_FieldInvalidate(&pressField);
+    UI_FieldInvalidate(&lightField);
+    UI_FieldInvalidate(&ppfdField);
+    UI_FullReportUpdate(handle);
+}
+
+void UI_FullReportUpdate(UART* handle) {
+    UI_TempReportUpdate(handle);
+    UI_PressureReportUpdate(handle);
+    UI_LightFieldsUpdate(handle);
 }
 
 void UI_Settings(UART* handle) {
@@ -188,6 +313,7 @@ void UI_Settings(UART* handle) {
     UART_Print(handle, "------------------------------------------\r\n");
     UART_Print(handle, "[1] - Change logging interval\r\n");
     UART_Print(handle, "[2] - Change no. logged data display\r\n");
+    UART_Print(handle, "[3] - Change debug output verbosity\r\n");
     UART_Print(handle, "[X] - Go back\r\n");
     UART_Print(handle, "------------------------------------------\r\n");
 }
@@ -213,6 +339,23 @@ void UI_SettingsLogSize(UART* handle) {
     UART_Print(handle, "Value will be changed after assertion.\r\n");
     UART_Print(handle, "------------------------------------------\r\n");
 }
+void UI_SettingsLogLevel(UART* handle) {
+    UART_ClearTerminal(handle);
+    UART_Print(handle, "------------------------------------------\r\n");
+    UART_Print(handle, "Debug output verbosity:\r\n");
+    uint8_t i;
+    for (i = 0; i < LOG_MODULE_COUNT; ++i) {
+        UART_Printf(handle, "[%d] %s: %s\r\n", i, Logger_ModuleName(i), Logger_LevelName(Logger_GetLevel(i)));
+    }
+    UART_Print(handle, "------------------------------------------\r\n");
+    UART_Printf(handle, "Levels: %d - DEBUG, %d - INFO, %d - WARN, %d - ERROR, %d - OFF\r\n",
+        LOG_LEVEL_DEBUG, LOG_LEVEL_INFO, LOG_LEVEL_WARN, LOG_LEVEL_ERROR, LOG_LEVEL_NONE);
+    UART_Print(handle, "Enter module number followed by level,\r\n" \
+                       "e.g. 24 turns LPS22HH output off.\r\n");
+    UART_Print(handle, "Value will be changed after assertion.\r\n");
+    UART_Print(handle, "------------------------------------------\r\n");
+}
+
 void UI_DebugWelcome(UART* handle) {
     UART_Print(handle, "----------------------------------------\r\n");
     UART_Print(handle, "GreenWatch - Debug Interface Initialised\r\n");
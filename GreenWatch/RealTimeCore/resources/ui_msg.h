@@ -8,41 +8,72 @@
 #include "../lib/Print.h"
 #include "../lib/ADC.h"
 #include "utilities.h"
+#include "stats.h"
+#include "channels.h"
+#include "light.h"
+#include "dli.h"
 #include "LPS22HH.h"
 
 typedef struct {
     uint8_t mainMenu;
     uint8_t subMenu;
+    // Draws the whole screen, called once when the menu changes.
     void (*Callback)(UART*);
+    // Redraws the changed values of a live screen, called on every sample, may be NULL.
+    void (*Update)(UART*);
     bool refreshMenu;
 } currentMenu;
 
+// A value printed at a fixed screen position. The last value printed is remembered so an
+// update only goes out on the UART when the displayed text would change.
+typedef struct {
+    uint8_t row;
+    uint8_t col;
+    const char* unit;
+    bool valid;
+    int32_t shown; // Last value printed, in thousandths.
+} UI_Field;
+
 void updateMenuCallback(currentMenu* handle);
 
 void UART_ClearTerminal(UART* handle);
 
+void UI_FieldInvalidate(UI_Field* field);
+
+void UI_FieldUpdate(UART* handle, UI_Field* field, float_t value);
+
 void UI_DisplayMenu(UART* handle);
 
 void UI_TempReportCurrent(UART* handle);
 
+void UI_TempReportUpdate(UART* handle);
+
 void UI_TempReportInterval(UART* handle);
 
 void UI_PressureReportCurrent(UART* handle);
 
+void UI_PressureReportUpdate(UART* handle);
+
 void UI_PressureReportInterval(UART* handle);
 
 void UI_LightReportCurrent(UART* handle);
 
+void UI_LightReportUpdate(UART* handle);
+
 void UI_LightReportInterval(UART* handle);
 
 void UI_FullReportCurrent(UART* handle);
 
+void UI_FullReportUpdate(UART* handle);
+
 void UI_Settings(UART* handle);
 
 void UI_SettingsInterval(UART* handle);
 
 void UI_SettingsLogSize(UART* handle);
 
+void UI_SettingsLogLevel(UART* handle);
+
 void UI_DebugWelcome(UART* handle);
 
 
@@ -4,41 +4,156 @@
 #include <stdint.h>
 #include<stdbool.h>
 
-#define MAX_BUFFER_SIZE 20
-#define ADC_DATA_SIZE 1
+// The ADC scans channels 0 to 3 and averages each, adcData holds one value per channel.
+#define ADC_DATA_SIZE 4
+#define ADC_CHANNEL_LIGHT 0
 #define ADC_MAX_VAL 0xFFF
 
-typedef struct {
-	int16_t data[MAX_BUFFER_SIZE];
-	int16_t* input;
-	int16_t* output;
-	uint8_t size;
-	bool overwrite;
-} ringBuffer_int16;
+// Memory placement, see lib/linker.ld. Code and data default to the TCM. Code which runs once
+// or only for the user interface goes to XIP flash with XIP_CODE and constant tables with
+// XIP_RODATA; large buffers which don't need single cycle access go to SYSRAM.
+#define XIP_CODE    __attribute__((section(".xip.text"), noinline))
+#define XIP_RODATA  __attribute__((section(".xip.rodata")))
+#define SYSRAM_DATA __attribute__((section(".sysram")))
 
-typedef struct {
-	uint32_t data[MAX_BUFFER_SIZE];
-	uint32_t* input;
-	uint32_t* output;
-	uint8_t size;
-	bool overwrite;
-} ringBuffer_uint32;
+// Ring buffers are generated per element type and capacity with RINGBUFFER_DEFINE. The
+// capacity must be a power of two, head and tail are free-running counters which are masked
+// on access, so any capacity costs the same per operation and head - tail is always the fill
+// level.
+//
+// Push and Pop are safe with one producer and one consumer in different contexts (e.g. an
+// interrupt and the main loop) without blocking interrupts: each side only writes its own
+// counter, after the element access it guards.
+//
+// Write overwrites the oldest element when full and Peek reads without consuming, for logs.
+// Write publishes the element like Push, so a Snapshot can run in another context. Readers never
+// move the tail, so any number of them can look at the same log:
+// - a Cursor walks from a given age towards older elements and stays on the same element when
+//   newer ones are written, it ends where the writer has overwritten the log;
+// - Snapshot copies the latest elements oldest first with at most two memcpy() calls and
+//   retries if the log was written meanwhile, so the copy is consistent;
+// - CountAbove binary searches a log written in ascending order, e.g. timestamps.
 
-void ringBuffer_int16_Init(ringBuffer_int16* handle, const uint8_t size);
+#ifndef RINGBUFFER_BARRIER
+#define RINGBUFFER_BARRIER() __asm__ volatile ("dmb" ::: "memory")
+#endif
 
-bool ringBuffer_int16_Write(ringBuffer_int16* handle, const int16_t val);
-
-bool ringBuffer_int16_Read(ringBuffer_int16* handle, int16_t* val);
-
-void ringBuffer_int16_Resize(ringBuffer_int16* handle, const uint8_t val);
-
-void ringBuffer_uint32_Init(ringBuffer_uint32* handle, const uint8_t size);
-
-bool ringBuffer_uint32_Write(ringBuffer_uint32* handle, const uint32_t val);
-
-bool ringBuffer_uint32_Read(ringBuffer_uint32* handle, uint32_t* val);
-
-void ringBuffer_uint32_Resize(ringBuffer_uint32* handle, const uint8_t val);
+#define RINGBUFFER_DEFINE(name, type, capacity) \
+	_Static_assert(((capacity) & ((capacity) - 1)) == 0, #name " capacity must be a power of two"); \
+	\
+	typedef struct { \
+		type data[capacity]; \
+		volatile uint32_t head; \
+		volatile uint32_t tail; \
+	} name; \
+	\
+	static inline void name##_Init(name* handle) { \
+		handle->head = 0; \
+		handle->tail = 0; \
+	} \
+	\
+	static inline uint32_t name##_Capacity(void) { \
+		return (capacity); \
+	} \
+	\
+	static inline uint32_t name##_Count(const name* handle) { \
+		return handle->head - handle->tail; \
+	} \
+	\
+	static inline bool name##_Push(name* handle, const type val) { \
+		uint32_t head = handle->head; \
+		if ((head - handle->tail) >= (capacity)) { \
+			return false; \
+		} \
+		handle->data[head & ((capacity) - 1)] = val; \
+		RINGBUFFER_BARRIER(); \
+		handle->head = head + 1; \
+		return true; \
+	} \
+	\
+	static inline bool name##_Pop(name* handle, type* val) { \
+		uint32_t tail = handle->tail; \
+		if (tail == handle->head) { \
+			return false; \
+		} \
+		RINGBUFFER_BARRIER(); \
+		*val = handle->data[tail & ((capacity) - 1)]; \
+		RINGBUFFER_BARRIER(); \
+		handle->tail = tail + 1; \
+		return true; \
+	} \
+	\
+	static inline void name##_Write(name* handle, const type val) { \
+		uint32_t head = handle->head; \
+		handle->data[head & ((capacity) - 1)] = val; \
+		RINGBUFFER_BARRIER(); \
+		handle->head = ++head; \
+		if ((head - handle->tail) > (capacity)) { \
+			handle->tail = head - (capacity); \
+		} \
+	} \
+	\
+	static inline bool name##_Peek(const name* handle, const uint32_t age, type* val) { \
+		if (age >= (handle->head - handle->tail)) { \
+			return false; \
+		} \
+		*val = handle->data[(handle->head - 1 - age) & ((capacity) - 1)]; \
+		return true; \
+	} \
+	\
+	typedef struct { \
+		const name* handle; \
+		uint32_t    index; \
+	} name##_Cursor; \
+	\
+	static inline void name##_CursorInit(name##_Cursor* cursor, const name* handle, const uint32_t age) { \
+		cursor->handle = handle; \
+		cursor->index  = handle->head - 1 - age; \
+	} \
+	\
+	static inline bool name##_CursorNext(name##_Cursor* cursor, type* val) { \
+		const name* handle = cursor->handle; \
+		uint32_t head = handle->head; \
+		if ((head - 1 - cursor->index) >= (head - handle->tail)) { \
+			return false; \
+		} \
+		*val = handle->data[cursor->index & ((capacity) - 1)]; \
+		cursor->index--; \
+		return true; \
+	} \
+	\
+	static inline uint32_t name##_Snapshot(const name* handle, type* dst, const uint32_t max) { \
+		uint32_t head, count; \
+		do { \
+			head  = handle->head; \
+			count = head - handle->tail; \
+			if (count > max) { \
+				count = max; \
+			} \
+			uint32_t first = (head - count) & ((capacity) - 1); \
+			uint32_t part  = (capacity) - first; \
+			if (part > count) { \
+				part = count; \
+			} \
+			__builtin_memcpy(dst, &handle->data[first], part * sizeof(type)); \
+			__builtin_memcpy(&dst[part], handle->data, (count - part) * sizeof(type)); \
+			RINGBUFFER_BARRIER(); \
+		} while (handle->head != head); \
+		return count; \
+	} \
+	\
+	static inline uint32_t name##_CountAbove(const name* handle, const type val) { \
+		uint32_t lo = 0, hi = handle->head - handle->tail; \
+		while (lo < hi) { \
+			uint32_t mid = (lo + hi) / 2; \
+			if (handle->data[(handle->head - 1 - mid) & ((capacity) - 1)] > val) { \
+				lo = mid + 1; \
+			} \
+			else { \
+				hi = mid; \
+			} \
+		} \
+		return lo; \
+	}
 
 #endif // #ifndef UTILITIES_H_
-
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Decodes deferred log frames captured from the RealTimeCore debug UART.
+
+Extract the format string table from the application ELF first:
+
+    arm-none-eabi-objcopy --dump-section .log_fmt=log_fmt.bin GreenWatch_RealTimeCore.out
+
+then decode a capture file, or a serial port opened with pyserial:
+
+    logdecode.py log_fmt.bin capture.bin
+    logdecode.py log_fmt.bin /dev/ttyUSB0 --baud 115200
+
+Bytes outside frames (e.g. the welcome banner) are passed through unchanged.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+FRAME_START = 0xFE
+TOKEN_DROPPED = 0xFFFF
+
+SPEC = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z)?([diuxXocfs%])")
+
+
+def format_string(table, token):
+    end = table.find(b"\0", token)
+    if end < 0:
+        return None
+    return table[token:end].decode("ascii", errors="replace")
+
+
+def render(fmt, args):
+    words = iter(args)
+
+    def substitute(match):
+        flags, conv = match.group(1), match.group(2)
+        if conv == "%":
+            return "%"
+        word = next(words, 0)
+        if conv == "f":
+            value = struct.unpack("<f", struct.pack("<I", word))[0]
+        elif conv in "di":
+            value = struct.unpack("<i", struct.pack("<I", word))[0]
+        elif conv == "c":
+            value = chr(word & 0xFF)
+        elif conv == "s":
+            return "<0x%08x>" % word
+        else:
+            value = word
+        return ("%" + flags + conv) % value
+
+    return SPEC.sub(substitute, fmt)
+
+
+def decode(table, stream, out):
+    while True:
+        byte = stream.read(1)
+        if not byte:
+            return
+        if byte[0] != FRAME_START:
+            out.write(byte.decode("ascii", errors="replace"))
+            continue
+
+        header = stream.read(3)
+        if len(header) < 3:
+            return
+        count = header[0]
+        token = header[1] | (header[2] << 8)
+        payload = stream.read(4 * count)
+        if len(payload) < 4 * count:
+            return
+        args = struct.unpack("<%dI" % count, payload)
+
+        if token == TOKEN_DROPPED:
+            out.write("[%u log entries dropped]\n" % args[0])
+            continue
+
+        fmt = format_string(table, token)
+        if fmt is None:
+            out.write("[unknown token 0x%04x %s]\n" % (token, list(args)))
+        else:
+            out.write(render(fmt, args).replace("\r\n", "\n"))
+        out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("table", help=".log_fmt section dumped from the ELF")
+    parser.add_argument("input", help="capture file or serial port")
+    parser.add_argument("--baud", type=int, help="open input as a serial port at this baud rate")
+    args = parser.parse_args()
+
+    with open(args.table, "rb") as f:
+        table = f.read()
+
+    if args.baud:
+        import serial
+        stream = serial.Serial(args.input, args.baud)
+    else:
+        stream = open(args.input, "rb")
+
+    with stream:
+        decode(table, stream, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
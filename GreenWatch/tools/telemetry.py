@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Decodes the binary telemetry stream from the RealTimeCore UI UART.
+
+Select "[9] - Binary telemetry stream" in the menu first, then:
+
+    telemetry.py capture.bin
+    telemetry.py /dev/ttyUSB1 --baud 115200
+
+Prints one CSV line per sample. Frames with a bad CRC are counted and skipped.
+The compressed history sent by the "export" command is decoded the same way,
+with the frame sequence number on every sample of a block. Daily light
+integral records go to stderr, so they don't mix with the CSV.
+"""
+
+import argparse
+import struct
+import sys
+
+RECORD_SAMPLE = 1
+RECORD_BLOCK = 2
+RECORD_DLI = 3
+SAMPLE = struct.Struct("<BBIhIH")
+BLOCK = struct.Struct("<BBH")
+DLI = struct.Struct("<BBHBIHH")
+NO_ONSET = 0xFFFF
+CHANNELS = 3
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(frame):
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame) + 1:
+            return None
+        out += frame[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+def varints(data):
+    value = shift = 0
+    for byte in data:
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            yield (value >> 1) ^ -(value & 1)
+            value = shift = 0
+
+
+def block_samples(data, count):
+    """Decodes a sample_log.c block: delta-of-delta timestamp, then a delta per channel.
+
+    Raises StopIteration if the block holds fewer than count samples; this is a
+    plain function, not a generator, so the exception reaches the caller.
+    """
+    fields = varints(data)
+    timestamp = interval = 0
+    values = [0] * CHANNELS
+    samples = []
+    for _ in range(count):
+        interval = (interval + next(fields)) & 0xFFFFFFFF
+        timestamp = (timestamp + interval) & 0xFFFFFFFF
+        for i in range(CHANNELS):
+            values[i] = ((values[i] + next(fields) + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+        samples.append((timestamp, *values))
+    return samples
+
+
+def frames(stream):
+    frame = bytearray()
+    while True:
+        byte = stream.read(1)
+        if not byte:
+            return
+        if byte[0] == 0:
+            yield bytes(frame)
+            frame.clear()
+        else:
+            frame += byte
+
+
+def decode(stream, out):
+    bad = 0
+    last = None
+    out.write("sequence,timestamp_ms,temperature_c,pressure_hpa,light_raw\n")
+    for frame in frames(stream):
+        record = cobs_decode(frame)
+        if record is None or len(record) < 3 or crc16(record[:-2]) != struct.unpack("<H", record[-2:])[0]:
+            bad += 1
+            sys.stderr.write("bad frame (%u so far)\n" % bad)
+            continue
+        record = record[:-2]
+        if len(record) < 2:
+            continue
+        # Every record type shares the sequence, so any of them closes a gap.
+        seq = record[1]
+        if last is not None and seq != (last + 1) & 0xFF:
+            sys.stderr.write("lost %u frames\n" % ((seq - last - 1) & 0xFF))
+        last = seq
+        if record[0] == RECORD_SAMPLE and len(record) == SAMPLE.size:
+            _, _, ts, temp, press, light = SAMPLE.unpack(record)
+            samples = [(ts, temp, press, light)]
+        elif record[0] == RECORD_BLOCK and len(record) >= BLOCK.size:
+            _, _, count = BLOCK.unpack(record[:BLOCK.size])
+            try:
+                samples = block_samples(record[BLOCK.size:], count)
+            except StopIteration:
+                sys.stderr.write("truncated block\n")
+                continue
+        elif record[0] == RECORD_DLI and len(record) == DLI.size:
+            _, _, day, closed, integral, photoperiod, onset = DLI.unpack(record)
+            sys.stderr.write("day %u%s: DLI %.3f mol/m2, photoperiod %u min, onset %s\n" % (
+                day, "" if closed else " (open)", integral / 1000.0, photoperiod,
+                "none" if onset == NO_ONSET else "%02u:%02u" % divmod(onset, 60)))
+            continue
+        else:
+            continue
+        for ts, temp, press, light in samples:
+            out.write("%u,%u,%.2f,%.3f,%u\n" % (seq, ts, temp / 100.0, press / 4096.0, light))
+        out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="capture file or serial port")
+    parser.add_argument("--baud", type=int, help="open input as a serial port at this baud rate")
+    args = parser.parse_args()
+
+    if args.baud:
+        import serial
+        stream = serial.Serial(args.input, args.baud)
+    else:
+        stream = open(args.input, "rb")
+
+    with stream:
+        decode(stream, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()